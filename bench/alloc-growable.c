@@ -0,0 +1,76 @@
+/** @file
+  Compares appending to growable memory with a buffer managed via
+  realloc().
+*/
+
+#include "alloc-growable.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/** The amount of elements after which a new buffer gets started. */
+#define elements_per_buffer 65536
+
+/** Appends one element per iteration to growable region memory. */
+static void appendGrowable(size_t iterations)
+{
+  CR_Region *r = CR_RegionNew();
+  uint32_t *buffer = NULL;
+  size_t length = 0;
+
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    if(buffer == NULL || length == elements_per_buffer)
+    {
+      CR_RegionReset(r);
+      buffer = CR_RegionAllocGrowable(r, sizeof *buffer);
+      length = 0;
+    }
+
+    buffer = CR_EnsureCapacity(buffer, (length + 1) * sizeof *buffer);
+    buffer[length] = (uint32_t)counter;
+    length++;
+  }
+  benchUse(buffer);
+
+  CR_RegionRelease(r);
+}
+
+/** Baseline for appendGrowable(), which doubles the capacity of its
+  buffer when it is full. */
+static void appendRealloc(size_t iterations)
+{
+  uint32_t *buffer = NULL;
+  size_t length = 0;
+  size_t capacity = 0;
+
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    if(buffer == NULL || length == elements_per_buffer)
+    {
+      free(buffer);
+      capacity = 1;
+      buffer = benchRealloc(NULL, capacity * sizeof *buffer);
+      length = 0;
+    }
+    else if(length == capacity)
+    {
+      capacity *= 2;
+      buffer = benchRealloc(buffer, capacity * sizeof *buffer);
+    }
+
+    buffer[length] = (uint32_t)counter;
+    length++;
+  }
+  benchUse(buffer);
+
+  free(buffer);
+}
+
+int main(void)
+{
+  runBenchmark("CR_EnsureCapacity_append", appendGrowable, 20000000);
+  runBenchmark("realloc_append", appendRealloc, 20000000);
+}
@@ -0,0 +1,139 @@
+/** @file
+  Implements functions for measuring the performance of code.
+*/
+
+/* Required for wait4(). */
+#define _DEFAULT_SOURCE
+#ifdef __APPLE__
+#define _DARWIN_C_SOURCE
+#endif
+
+#include "bench.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Prevents the compiler from optimizing away values passed to
+  benchUse(). */
+static void *volatile bench_sink = NULL;
+
+/** Returns the current time of a monotonic clock in nanoseconds. */
+static double getNanoseconds(void)
+{
+  struct timespec time;
+  if(clock_gettime(CLOCK_MONOTONIC, &time) != 0)
+  {
+    fprintf(stderr, "failed to query monotonic clock\n");
+    exit(EXIT_FAILURE);
+  }
+
+  return (double)time.tv_sec * 1e9 + (double)time.tv_nsec;
+}
+
+/** Terminates the benchmark with the given error message. */
+static void benchFail(const char *message)
+{
+  fprintf(stderr, "%s\n", message);
+  exit(EXIT_FAILURE);
+}
+
+/** Converts the given peak resident set size to KiB. */
+static long getPeakRssKiB(const struct rusage *usage)
+{
+#ifdef __APPLE__
+  return usage->ru_maxrss / 1024;
+#else
+  return usage->ru_maxrss;
+#endif
+}
+
+/** Runs the given function and returns the measured time per iteration
+  in nanoseconds. */
+static double measure(BenchFunction *function, size_t iterations)
+{
+  /* Warm up caches and the allocator. */
+  function(iterations / 10 + 1);
+
+  const double start = getNanoseconds();
+  function(iterations);
+  const double elapsed = getNanoseconds() - start;
+
+  return elapsed / (double)iterations;
+}
+
+/** Runs the given function and prints the measured time per iteration in
+  a machine-readable format. Each benchmark runs in its own child process,
+  so the reported peak RSS covers only this benchmark.
+
+  @param name The name of the benchmark. Should not contain spaces.
+  @param function The function to measure.
+  @param iterations The amount of iterations to pass to the function.
+*/
+void runBenchmark(const char *name, BenchFunction *function,
+                  size_t iterations)
+{
+  int fds[2];
+  if(pipe(fds) != 0)
+  {
+    benchFail("failed to create pipe");
+  }
+
+  /* Prevent the child from printing buffered output twice. */
+  fflush(stdout);
+  const pid_t pid = fork();
+  if(pid == -1)
+  {
+    benchFail("failed to fork benchmark");
+  }
+  else if(pid == 0)
+  {
+    close(fds[0]);
+    const double ns_per_op = measure(function, iterations);
+    const bool success =
+      write(fds[1], &ns_per_op, sizeof ns_per_op) == sizeof ns_per_op;
+    _exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  close(fds[1]);
+  double ns_per_op;
+  const bool received =
+    read(fds[0], &ns_per_op, sizeof ns_per_op) == sizeof ns_per_op;
+  close(fds[0]);
+
+  int status;
+  struct rusage usage;
+  if(wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) ||
+     WEXITSTATUS(status) != EXIT_SUCCESS || !received)
+  {
+    benchFail("benchmark failed");
+  }
+
+  printf("benchmark=%s ns_per_op=%.3f ops_per_sec=%.0f peak_rss_kib=%ld\n",
+         name, ns_per_op, 1e9 / ns_per_op, getPeakRssKiB(&usage));
+}
+
+/** Marks the given pointer as used, to prevent the compiler from
+  optimizing away the code which produced it. */
+void benchUse(void *ptr)
+{
+  bench_sink = ptr;
+}
+
+/** Like realloc(), but terminates the benchmark on failure. Passing NULL
+  allocates new memory. */
+void *benchRealloc(void *ptr, size_t size)
+{
+  void *data = realloc(ptr, size);
+  if(data == NULL)
+  {
+    fprintf(stderr, "failed to allocate %zu bytes\n", size);
+    exit(EXIT_FAILURE);
+  }
+
+  return data;
+}
@@ -0,0 +1,19 @@
+/** @file
+  Declares functions for measuring the performance of code. This header
+  should only be included by benchmarks.
+*/
+
+#ifndef CREGION_BENCH_BENCH_H
+#define CREGION_BENCH_BENCH_H
+
+#include <stddef.h>
+
+/** A function which runs the code to measure the given amount of times. */
+typedef void BenchFunction(size_t iterations);
+
+extern void runBenchmark(const char *name, BenchFunction *function,
+                         size_t iterations);
+extern void benchUse(void *ptr);
+extern void *benchRealloc(void *ptr, size_t size);
+
+#endif
@@ -0,0 +1,161 @@
+/** @file
+  Compares allocating and destroying objects from a thread-safe memory
+  pool shared by multiple threads with malloc() and free().
+*/
+
+#include "mempool.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/** The amount of objects which are alive in each thread at the same
+  time. */
+#define live_objects 1024
+
+/** The size of each object. */
+#define object_size 48
+
+/** The maximal amount of threads to benchmark. */
+#define max_threads 64
+
+/** The amount of threads used by the current benchmark. */
+static size_t thread_count = 1;
+
+/** The pool shared by all threads in churnCaches(). */
+static CR_Mempool *shared_pool = NULL;
+
+/** Replaces the oldest object in each iteration using a cache of the
+  shared pool. */
+static void *churnCache(void *data)
+{
+  const size_t iterations = *(size_t *)data;
+  void **objects = benchRealloc(NULL, sizeof(void *) * live_objects);
+
+  CR_MempoolCache *cache = CR_MempoolCacheNew(shared_pool);
+  for(size_t index = 0; index < live_objects; index++)
+  {
+    objects[index] = CR_MempoolCacheAlloc(cache);
+  }
+
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    const size_t index = counter % live_objects;
+    CR_MempoolCacheDestroyObject(cache, objects[index]);
+    objects[index] = CR_MempoolCacheAlloc(cache);
+    benchUse(objects[index]);
+  }
+
+  for(size_t index = 0; index < live_objects; index++)
+  {
+    CR_MempoolCacheDestroyObject(cache, objects[index]);
+  }
+  CR_MempoolCacheFlush(cache);
+  free(objects);
+
+  return NULL;
+}
+
+/** Baseline for churnCache(). */
+static void *churnMalloc(void *data)
+{
+  const size_t iterations = *(size_t *)data;
+  void **objects = benchRealloc(NULL, sizeof(void *) * live_objects);
+  for(size_t index = 0; index < live_objects; index++)
+  {
+    objects[index] = benchRealloc(NULL, object_size);
+  }
+
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    const size_t index = counter % live_objects;
+    free(objects[index]);
+    objects[index] = benchRealloc(NULL, object_size);
+    benchUse(objects[index]);
+  }
+
+  for(size_t index = 0; index < live_objects; index++)
+  {
+    free(objects[index]);
+  }
+  free(objects);
+
+  return NULL;
+}
+
+/** Splits the given iterations between thread_count threads, each running
+  the given function. */
+static void runThreads(void *(*function)(void *), size_t iterations)
+{
+  static pthread_t threads[max_threads];
+  size_t per_thread = iterations / thread_count + 1;
+
+  for(size_t index = 0; index < thread_count; index++)
+  {
+    if(pthread_create(&threads[index], NULL, function, &per_thread) != 0)
+    {
+      fprintf(stderr, "failed to create thread\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  for(size_t index = 0; index < thread_count; index++)
+  {
+    if(pthread_join(threads[index], NULL) != 0)
+    {
+      fprintf(stderr, "failed to join thread\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+/** Runs churnCache() in all threads, which share one pool. */
+static void churnCaches(size_t iterations)
+{
+  static const CR_MempoolOptions options = { .thread_safe = true };
+
+  CR_Region *r = CR_RegionNew();
+  shared_pool = CR_MempoolNewWithOptions(r, object_size, NULL, NULL, &options);
+  runThreads(churnCache, iterations);
+  CR_RegionRelease(r);
+}
+
+/** Runs churnMalloc() in all threads. */
+static void churnMallocs(size_t iterations)
+{
+  runThreads(churnMalloc, iterations);
+}
+
+/** Runs all benchmarks with the given amount of threads. */
+static void runWithThreads(size_t count)
+{
+  thread_count = count;
+
+  char name[64];
+  snprintf(name, sizeof(name), "CR_MempoolCacheAlloc_%zu_threads", thread_count);
+  runBenchmark(name, churnCaches, 20000000);
+  snprintf(name, sizeof(name), "malloc_free_48_%zu_threads", thread_count);
+  runBenchmark(name, churnMallocs, 20000000);
+}
+
+int main(void)
+{
+  long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+  if(cpu_count < 1)
+  {
+    cpu_count = 1;
+  }
+  else if(cpu_count > max_threads)
+  {
+    cpu_count = max_threads;
+  }
+
+  /* The real CPU count gets measured even if it is not a power of two. */
+  for(size_t count = 1; count < (size_t)cpu_count; count *= 2)
+  {
+    runWithThreads(count);
+  }
+  runWithThreads((size_t)cpu_count);
+}
@@ -0,0 +1,143 @@
+/** @file
+  Compares allocating and destroying objects from memory pools with
+  malloc() and free().
+*/
+
+#include "mempool.h"
+
+#include <stdlib.h>
+
+#include "bench.h"
+
+/** The amount of objects which are alive at the same time. */
+#define live_objects 1024
+
+/** The size of each object. */
+#define object_size 48
+
+/** Replaces the oldest of all live objects in each iteration. */
+static void churnMempool(size_t iterations)
+{
+  static void *objects[live_objects];
+
+  CR_Region *r = CR_RegionNew();
+  CR_Mempool *mp = CR_MempoolNew(r, object_size, NULL, NULL);
+  for(size_t index = 0; index < live_objects; index++)
+  {
+    objects[index] = CR_MempoolAlloc(mp);
+  }
+
+  /* Replace the oldest object in each iteration. */
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    const size_t index = counter % live_objects;
+    CR_DestroyObject(objects[index]);
+    objects[index] = CR_MempoolAlloc(mp);
+    benchUse(objects[index]);
+  }
+
+  CR_RegionRelease(r);
+}
+
+/** The amount of objects allocated and destroyed by churnMempoolBatch()
+  at once. */
+#define batch_size 64
+
+/** Like churnMempool(), but replaces objects in batches. */
+static void churnMempoolBatch(size_t iterations)
+{
+  static void *objects[live_objects];
+
+  CR_Region *r = CR_RegionNew();
+  CR_Mempool *mp = CR_MempoolNew(r, object_size, NULL, NULL);
+  CR_MempoolAllocBatch(mp, objects, live_objects);
+
+  for(size_t counter = 0; counter < iterations; counter += batch_size)
+  {
+    void **batch = &objects[counter % live_objects];
+    CR_DestroyObjects(batch, batch_size);
+    CR_MempoolAllocBatch(mp, batch, batch_size);
+    benchUse(batch[0]);
+  }
+
+  CR_RegionRelease(r);
+}
+
+/** Increments the first byte of the given object. */
+static void touchObject(void *object, void *data)
+{
+  (void)data;
+  (*(unsigned char *)object)++;
+}
+
+/** Visits each live object in a pool once per iteration. */
+static void iterateMempool(size_t iterations)
+{
+  static void *objects[live_objects];
+
+  CR_Region *r = CR_RegionNew();
+  CR_Mempool *mp = CR_MempoolNew(r, object_size, NULL, NULL);
+  CR_MempoolAllocBatch(mp, objects, live_objects);
+
+  for(size_t counter = 0; counter < iterations; counter += live_objects)
+  {
+    CR_MempoolForEach(mp, touchObject, NULL);
+  }
+  benchUse(objects[0]);
+
+  CR_RegionRelease(r);
+}
+
+/** Baseline for churnMempool(). */
+static void churnMalloc(size_t iterations)
+{
+  static void *objects[live_objects];
+  for(size_t index = 0; index < live_objects; index++)
+  {
+    objects[index] = benchRealloc(NULL, object_size);
+  }
+
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    const size_t index = counter % live_objects;
+    free(objects[index]);
+    objects[index] = benchRealloc(NULL, object_size);
+    benchUse(objects[index]);
+  }
+
+  for(size_t index = 0; index < live_objects; index++)
+  {
+    free(objects[index]);
+  }
+}
+
+/** The amount of objects allocated from each pool in
+  createPoolInRegion(). */
+#define objects_per_region 8
+
+/** Creates a region with a small pool per iteration, like a server which
+  uses one region per request. */
+static void createPoolInRegion(size_t iterations)
+{
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_Mempool *mp = CR_MempoolNew(r, object_size, NULL, NULL);
+    for(size_t index = 0; index < objects_per_region; index++)
+    {
+      benchUse(CR_MempoolAlloc(mp));
+    }
+    CR_RegionRelease(r);
+  }
+}
+
+int main(void)
+{
+  runBenchmark("CR_MempoolAlloc_CR_DestroyObject", churnMempool, 20000000);
+  runBenchmark("CR_MempoolAllocBatch_CR_DestroyObjects", churnMempoolBatch,
+               20000000);
+  runBenchmark("malloc_free_48", churnMalloc, 20000000);
+  runBenchmark("CR_MempoolForEach", iterateMempool, 200000000);
+  runBenchmark("CR_RegionNew_CR_MempoolNew_CR_RegionRelease",
+               createPoolInRegion, 2000000);
+}
@@ -0,0 +1,162 @@
+/** @file
+  Compares the out-of-line region allocator with its inline fast path and
+  with malloc().
+*/
+
+#include "region.h"
+
+#include <stdlib.h>
+
+#include "bench.h"
+
+/** The amount of allocations after which the region gets reset. */
+#define allocations_per_reset 4096
+
+/** The amount of allocations between creating and releasing a region. */
+#define allocations_per_region 8
+
+/** Allocates 24 bytes per iteration via CR_RegionAlloc(). */
+static void allocOutOfLine(size_t iterations)
+{
+  CR_Region *r = CR_RegionNew();
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    benchUse(CR_RegionAlloc(r, 24));
+    if(counter % allocations_per_reset == 0)
+    {
+      CR_RegionReset(r);
+    }
+  }
+  CR_RegionRelease(r);
+}
+
+/** Like allocOutOfLine(), but uses CR_RegionAllocInline(). */
+static void allocInline(size_t iterations)
+{
+  CR_Region *r = CR_RegionNew();
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    benchUse(CR_RegionAllocInline(r, 24));
+    if(counter % allocations_per_reset == 0)
+    {
+      CR_RegionReset(r);
+    }
+  }
+  CR_RegionRelease(r);
+}
+
+/** Allocates 13 bytes per iteration via CR_RegionAllocUnaligned(). */
+static void allocUnalignedOutOfLine(size_t iterations)
+{
+  CR_Region *r = CR_RegionNew();
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    benchUse(CR_RegionAllocUnaligned(r, 13));
+    if(counter % allocations_per_reset == 0)
+    {
+      CR_RegionReset(r);
+    }
+  }
+  CR_RegionRelease(r);
+}
+
+/** Like allocUnalignedOutOfLine(), but uses
+  CR_RegionAllocUnalignedInline(). */
+static void allocUnalignedInline(size_t iterations)
+{
+  CR_Region *r = CR_RegionNew();
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    benchUse(CR_RegionAllocUnalignedInline(r, 13));
+    if(counter % allocations_per_reset == 0)
+    {
+      CR_RegionReset(r);
+    }
+  }
+  CR_RegionRelease(r);
+}
+
+/** Baseline for the functions above. Memory gets freed as often as the
+  regions get reset. */
+static void allocMalloc(size_t size, size_t iterations)
+{
+  static void *allocations[allocations_per_reset];
+  size_t allocation_count = 0;
+
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    allocations[allocation_count] = benchRealloc(NULL, size);
+    benchUse(allocations[allocation_count]);
+    allocation_count++;
+
+    if(allocation_count == allocations_per_reset)
+    {
+      for(size_t index = 0; index < allocation_count; index++)
+      {
+        free(allocations[index]);
+      }
+      allocation_count = 0;
+    }
+  }
+
+  for(size_t index = 0; index < allocation_count; index++)
+  {
+    free(allocations[index]);
+  }
+}
+
+/** Baseline for allocOutOfLine() and allocInline(). */
+static void allocMalloc24(size_t iterations)
+{
+  allocMalloc(24, iterations);
+}
+
+/** Baseline for the unaligned allocation functions. */
+static void allocMalloc13(size_t iterations)
+{
+  allocMalloc(13, iterations);
+}
+
+/** Creates a region with a few allocations per iteration. */
+static void createAndReleaseRegion(size_t iterations)
+{
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    CR_Region *r = CR_RegionNew();
+    for(size_t index = 0; index < allocations_per_region; index++)
+    {
+      benchUse(CR_RegionAlloc(r, 24));
+    }
+    CR_RegionRelease(r);
+  }
+}
+
+/** Baseline for createAndReleaseRegion(). */
+static void mallocAndFree(size_t iterations)
+{
+  void *allocations[allocations_per_region];
+  for(size_t counter = 0; counter < iterations; counter++)
+  {
+    for(size_t index = 0; index < allocations_per_region; index++)
+    {
+      allocations[index] = benchRealloc(NULL, 24);
+      benchUse(allocations[index]);
+    }
+    for(size_t index = 0; index < allocations_per_region; index++)
+    {
+      free(allocations[index]);
+    }
+  }
+}
+
+int main(void)
+{
+  runBenchmark("CR_RegionAlloc", allocOutOfLine, 50000000);
+  runBenchmark("CR_RegionAllocInline", allocInline, 50000000);
+  runBenchmark("CR_RegionAllocUnaligned", allocUnalignedOutOfLine, 50000000);
+  runBenchmark("CR_RegionAllocUnalignedInline", allocUnalignedInline, 50000000);
+  runBenchmark("malloc_24", allocMalloc24, 50000000);
+  runBenchmark("malloc_13", allocMalloc13, 50000000);
+  runBenchmark("CR_RegionNew_CR_RegionRelease", createAndReleaseRegion, 5000000);
+  runBenchmark("malloc_free_8x24", mallocAndFree, 5000000);
+}
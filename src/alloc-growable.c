@@ -4,35 +4,152 @@
 
 #include "alloc-growable.h"
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "address-sanitizer.h"
 #include "error-handling.h"
 #include "global-region.h"
+#include "page-alloc.h"
 #include "safe-math.h"
 #include "static-assert.h"
 
+/** The places in which growable memory can be stored. */
+typedef enum
+{
+  /** Inside a chunk of the region owning the memory. */
+  L_region,
+
+  /** Allocated via malloc(). */
+  L_heap,
+
+  /** Allocated via CR_PageAlloc(). */
+  L_pages,
+}Location;
+
 /** A header containing metadata for resizable fat pointers. */
 typedef struct
 {
-  /** A pointer for updating the pointer attached to the region. */
-  void **attached_pointer;
+  /** Binds the memory to its region, which owns it. Memory stored inside
+    the region only reserves its place in the order of creation, to keep
+    it when it moves out of the region. Must be the first member, to be
+    freeable by the region. */
+  CR_RegionBlock block;
 
   /** The capacity of the allocated memory. */
   size_t capacity;
+
+  /** The percentage by which the capacity grows at least when the memory
+    gets reallocated. Limited to 1000 by CR_SetGrowthPercent(). */
+  unsigned int growth_percent : 10;
+
+  /** The place where the memory is stored, as a Location. */
+  unsigned int location : 2;
 }Header;
 
-/** Frees the given resizable memory chunk attached to a region. */
-static void freeAttachedPointer(void *ptr)
+/** Memory chunks of this size or smaller are stored directly inside the
+  region, which avoids calling malloc() for buffers which never grow
+  much. */
+#define small_chunk_size 256
+
+/** Memory chunks of this size or larger get allocated directly from the
+  system. This allows growing them without copying their content. */
+#define large_chunk_size (1024 * 1024)
+
+/** The growth percentage of new growable memory. Growing by 50% keeps the
+  amount of copying when appending linear, while wasting less memory than
+  doubling. */
+#define default_growth_percent 50
+
+/** Poisons the given header, unless it is stored inside a region. Region
+  memory gets reused after rollbacks and must stay accessible. The block
+  stays accessible to the region, which updates it when other blocks get
+  freed or moved. */
+static void poisonHeader(Header *header)
+{
+  if(header->location != L_region)
+  {
+    ASAN_POISON_MEMORY_REGION(&header->capacity,
+                              sizeof(Header) - sizeof(CR_RegionBlock));
+  }
+}
+
+/** Returns the size which must be passed to the region for freeing the
+  chunk of the given header. */
+static size_t getMappedSize(const Header *header)
+{
+  return header->location == L_pages ?
+    sizeof(Header) + header->capacity : 0;
+}
+
+/** Allocates a chunk of the given size outside of the region, which must
+  be large enough to hold a Header. Returns NULL on failure. */
+static Header *allocChunk(size_t chunk_size)
 {
-  void **attached_pointer = ptr;
-  free(*attached_pointer);
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  if(chunk_size >= large_chunk_size)
+  {
+    Header *header = CR_PageAlloc(chunk_size);
+    header->location = L_pages;
+    return header;
+  }
+#endif
+
+  Header *header = malloc(chunk_size);
+  if(header != NULL)
+  {
+    header->location = L_heap;
+  }
+  return header;
+}
+
+/** Resizes the chunk of the given header to the specified capacity. Large
+  chunks get moved to memory pages, which can be grown without copying.
+  Chunks shrunk below the size of large chunks get moved back to the heap.
+
+  @return The resized chunk or NULL on failure. In this case the given
+  chunk stays unchanged.
+*/
+static Header *resizeChunk(Header *header, size_t capacity)
+{
+  const size_t old_chunk_size = sizeof(Header) + header->capacity;
+  const size_t chunk_size = sizeof(Header) + capacity;
+  if(header->location == L_pages && chunk_size >= large_chunk_size)
+  {
+    return CR_PageRealloc(header, old_chunk_size, chunk_size);
+  }
+  else if(header->location == L_heap && chunk_size < large_chunk_size)
+  {
+    return realloc(header, chunk_size);
+  }
+
+  Header *new_header = allocChunk(chunk_size);
+  if(new_header != NULL)
+  {
+    const unsigned int location = new_header->location;
+    memcpy(new_header, header,
+           chunk_size < old_chunk_size ? chunk_size : old_chunk_size);
+    new_header->location = location;
+    if(header->location == L_heap)
+    {
+      free(header);
+    }
+    else if(header->location == L_pages)
+    {
+      CR_PageFree(header, old_chunk_size);
+    }
+  }
+  return new_header;
 }
 
 /** Like CR_RegionAlloc(), but returns memory growable with
   CR_EnsureCapacity(). This function assures the same alignment guarantees
   as CR_RegionAlloc(). The returned memory will be released with the region
-  and should not be freed by the caller.
+  and should not be freed by the caller. Small memory gets stored inside
+  the region itself and has the same lifetime as memory returned by
+  CR_RegionAlloc(), until it outgrows the region.
 */
 void *CR_RegionAllocGrowable(CR_Region *r, size_t size)
 {
@@ -44,26 +161,74 @@ void *CR_RegionAllocGrowable(CR_Region *r, size_t size)
   CR_StaticAssert(sizeof(Header) % 8 == 0);
   const size_t chunk_size = CR_SafeAdd(sizeof(Header), size);
 
-  void **attached_pointer = CR_RegionAlloc(r, sizeof *attached_pointer);
-
-  Header *header = malloc(chunk_size);
-  if(header == NULL)
+  Header *header;
+  if(chunk_size <= small_chunk_size)
+  {
+    header = CR_RegionAlloc(r, chunk_size);
+    header->location = L_region;
+  }
+  else
   {
-    CR_ExitFailure("failed to allocate %zu bytes", chunk_size);
+    header = allocChunk(chunk_size);
+    if(header == NULL)
+    {
+      CR_ExitFailure("failed to allocate %zu bytes", chunk_size);
+    }
   }
 
-  *attached_pointer = header;
-  header->attached_pointer = attached_pointer;
   header->capacity = size;
+  header->growth_percent = default_growth_percent;
 
-  CR_RegionAttach(r, freeAttachedPointer, attached_pointer);
+  if(header->location == L_region)
+  {
+    CR_RegionReserveBlock(r, &header->block);
+  }
+  else
+  {
+    CR_RegionTrackBlock(r, &header->block, getMappedSize(header));
+  }
 
-  ASAN_POISON_MEMORY_REGION(header, sizeof(Header));
+  poisonHeader(header);
   return header + 1;
 }
 
+/** Returns the capacity of the given memory increased by its growth
+  percentage, or SIZE_MAX on overflow. */
+static size_t getGrownCapacity(const Header *header)
+{
+  const size_t capacity = header->capacity;
+  const size_t percent = header->growth_percent;
+  if(percent != 0 && capacity / 100 > (SIZE_MAX - capacity) / percent)
+  {
+    return SIZE_MAX;
+  }
+
+  /* Split the multiplication to avoid overflows. */
+  const size_t growth =
+    capacity / 100 * percent + capacity % 100 * percent / 100;
+  return growth > SIZE_MAX - capacity ? SIZE_MAX : capacity + growth;
+}
+
+/** Grows memory stored inside its region in place to the given capacity.
+  Copying it to another place in the region would waste the old copy until
+  the region gets released, so memory which can't be extended moves out of
+  the region instead.
+
+  @return True if the memory was grown.
+*/
+static bool growInRegion(Header *header, size_t capacity)
+{
+  const size_t chunk_size = CR_SafeAdd(sizeof(Header), capacity);
+  const size_t old_chunk_size = sizeof(Header) + header->capacity;
+
+  return chunk_size <= small_chunk_size &&
+    CR_RegionExtend(header->block.r, header, old_chunk_size, chunk_size);
+}
+
 /** Reallocates the given memory if it has not enough space to store the
-  requested size.
+  requested size. The new capacity will be larger than the requested size
+  according to the growth percentage of the memory, to make appending
+  cheap. See CR_SetGrowthPercent().
 
   @param ptr Memory allocated via CR_RegionAllocGrowable(). If ptr is NULL,
   memory will be allocated and bound to the lifetime of the entire program.
@@ -86,20 +251,156 @@ void *CR_EnsureCapacity(void *ptr, size_t size)
   ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
   if(size <= header->capacity)
   {
-    ASAN_POISON_MEMORY_REGION(header, sizeof(Header));
+    poisonHeader(header);
     return ptr;
   }
 
-  const size_t chunk_size = CR_SafeAdd(sizeof(Header), size);
-  Header *reallocated_header = realloc(header, chunk_size);
+  const size_t grown_capacity = getGrownCapacity(header);
+  size_t capacity = size;
+  Header *reallocated_header = NULL;
+  if(grown_capacity > size && grown_capacity <= SIZE_MAX - sizeof(Header))
+  {
+    capacity = grown_capacity;
+  }
+
+  /* Region memory allocated after a savepoint would be freed by rolling
+     back to it, while the buffer itself was created before. */
+  const bool was_in_region = (header->location == L_region);
+  if(was_in_region && !CR_RegionMarkedSince(&header->block) &&
+     growInRegion(header, capacity))
+  {
+    header->capacity = capacity;
+    return ptr;
+  }
+
+  if(capacity != size)
+  {
+    reallocated_header = resizeChunk(header, capacity);
+  }
+
+  /* Fall back to the requested size, which may still fit into memory. */
+  if(reallocated_header == NULL)
+  {
+    capacity = size;
+    const size_t chunk_size = CR_SafeAdd(sizeof(Header), size);
+    reallocated_header = resizeChunk(header, size);
+    if(reallocated_header == NULL)
+    {
+      CR_ExitFailure("failed to reallocate %zu bytes", chunk_size);
+    }
+  }
+
+  reallocated_header->capacity = capacity;
+  if(was_in_region)
+  {
+    CR_RegionTrackReservedBlock(&reallocated_header->block,
+                                getMappedSize(reallocated_header));
+  }
+  else
+  {
+    CR_RegionMoveBlock(&reallocated_header->block,
+                       getMappedSize(reallocated_header));
+  }
+
+  poisonHeader(reallocated_header);
+  return reallocated_header + 1;
+}
+
+/** Reduces the capacity of the given memory to the specified size, to
+  give unused memory back to the system. Memory stored inside its region
+  stays unchanged, because regions can not free parts of their chunks.
+
+  @param ptr Memory allocated via CR_RegionAllocGrowable().
+  @param size The amount of bytes that should still fit into the given
+  ptr. If it is not smaller than the capacity of ptr, nothing happens.
+
+  @return The possibly reallocated memory.
+*/
+void *CR_ShrinkToFit(void *ptr, size_t size)
+{
+  if(size == 0)
+  {
+    CR_ExitFailure("unable to allocate 0 bytes");
+  }
+
+  Header *header = (Header *)ptr - 1;
+  ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
+  if(header->location == L_region || size >= header->capacity)
+  {
+    poisonHeader(header);
+    return ptr;
+  }
+
+  /* The memory stays usable if it can not be shrunk. */
+  Header *reallocated_header = resizeChunk(header, size);
   if(reallocated_header == NULL)
   {
-    CR_ExitFailure("failed to reallocate %zu bytes", chunk_size);
+    poisonHeader(header);
+    return ptr;
   }
 
-  *reallocated_header->attached_pointer = reallocated_header;
   reallocated_header->capacity = size;
+  CR_RegionMoveBlock(&reallocated_header->block,
+                     getMappedSize(reallocated_header));
 
-  ASAN_POISON_MEMORY_REGION(reallocated_header, sizeof(Header));
+  poisonHeader(reallocated_header);
   return reallocated_header + 1;
 }
+
+/** Frees the given memory before its region gets released. Memory stored
+  inside its region will only be freed together with the region.
+
+  @param ptr Memory allocated via CR_RegionAllocGrowable(). Can be NULL.
+*/
+void CR_FreeGrowable(void *ptr)
+{
+  if(ptr == NULL)
+  {
+    return;
+  }
+
+  Header *header = (Header *)ptr - 1;
+  ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
+  if(header->location == L_region)
+  {
+    return;
+  }
+
+  CR_RegionFreeBlock(&header->block);
+}
+
+/** Returns the amount of bytes which fit into the given memory without
+  reallocating it.
+
+  @param ptr Memory allocated via CR_RegionAllocGrowable().
+*/
+size_t CR_GetCapacity(void *ptr)
+{
+  Header *header = (Header *)ptr - 1;
+  ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
+  const size_t capacity = header->capacity;
+  poisonHeader(header);
+
+  return capacity;
+}
+
+/** Sets the percentage by which the capacity of the given memory grows at
+  least when it gets reallocated by CR_EnsureCapacity(). Defaults to 50.
+
+  @param ptr Memory allocated via CR_RegionAllocGrowable().
+  @param percent The growth percentage, which must not be larger than 1000.
+  0 will grow the memory only to the requested size and 100 will double
+  its capacity.
+*/
+void CR_SetGrowthPercent(void *ptr, size_t percent)
+{
+  if(percent > 1000)
+  {
+    CR_ExitFailure("growth percentage of %zu is larger than 1000", percent);
+  }
+
+  Header *header = (Header *)ptr - 1;
+  ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
+  header->growth_percent = (unsigned int)percent;
+  poisonHeader(header);
+}
@@ -13,5 +13,13 @@ extern void *CR_EnsureCapacity(void *ptr, size_t size)
 __attribute__((warn_unused_result))
 #endif
   ;
+extern void *CR_ShrinkToFit(void *ptr, size_t size)
+#ifdef __GNUC__
+__attribute__((warn_unused_result))
+#endif
+  ;
+extern void CR_FreeGrowable(void *ptr);
+extern size_t CR_GetCapacity(void *ptr);
+extern void CR_SetGrowthPercent(void *ptr, size_t percent);
 
 #endif
@@ -0,0 +1,134 @@
+/** @file
+  Contains a minimal spinlock and lock-free helpers based on the atomic
+  builtins of GCC and Clang. Other compilers don't support thread-safe
+  features of this library.
+*/
+
+#ifndef CREGION_SRC_ATOMICS_H
+#define CREGION_SRC_ATOMICS_H
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CREGION_HAVE_ATOMICS
+#endif
+
+#if defined(CREGION_HAVE_ATOMICS) && \
+  (defined(__unix__) || defined(__APPLE__))
+#include <sched.h>
+#define CREGION_HAVE_SCHED_YIELD
+#endif
+
+/** The amount of times a spinlock gets polled with exponentially growing
+  pauses, before the waiting thread starts yielding its CPU. */
+#define CR_SPINLOCK_MAX_BACKOFF 10
+
+/** A spinlock, which is unlocked if zero. */
+typedef int CR_Spinlock;
+
+/** Waits before polling a spinlock again. Short waits pause the CPU for
+  an exponentially growing amount of cycles. If the lock stays taken, e.g.
+  because its holder got preempted, the CPU gets yielded to other threads.
+
+  @param attempts The amount of previous waits, which will be incremented.
+*/
+static inline void CR_SpinlockBackoff(unsigned int *attempts)
+{
+  if(*attempts >= CR_SPINLOCK_MAX_BACKOFF)
+  {
+#ifdef CREGION_HAVE_SCHED_YIELD
+    (void)sched_yield();
+#endif
+    return;
+  }
+
+  for(unsigned int counter = 0; counter < 1u << *attempts; counter++)
+  {
+#if defined(CREGION_HAVE_ATOMICS) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_ia32_pause();
+#endif
+  }
+  (*attempts)++;
+}
+
+/** Locks the given spinlock. Blocks until it becomes available. */
+static inline void CR_SpinlockAcquire(CR_Spinlock *lock)
+{
+#ifdef CREGION_HAVE_ATOMICS
+  unsigned int attempts = 0;
+  while(__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) != 0)
+  {
+    /* Wait without writing to the lock, to keep its cache line shared. */
+    while(__atomic_load_n(lock, __ATOMIC_RELAXED) != 0)
+    {
+      CR_SpinlockBackoff(&attempts);
+    }
+  }
+#else
+  (void)lock;
+#endif
+}
+
+/** Unlocks the given spinlock. */
+static inline void CR_SpinlockRelease(CR_Spinlock *lock)
+{
+#ifdef CREGION_HAVE_ATOMICS
+  __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+#else
+  (void)lock;
+#endif
+}
+
+/** Returns an address which is unique to the calling thread while it is
+  running. Returns NULL if threads are not supported. */
+static inline const void *CR_GetThreadId(void)
+{
+#ifdef CREGION_HAVE_ATOMICS
+  static __thread char marker;
+  return &marker;
+#else
+  return NULL;
+#endif
+}
+
+/** Atomically pushes an element or a chain of elements to the front of a
+  linked list which can be shared between multiple threads.
+
+  @param head The first element of the list. Must only be accessed via
+  atomic operations.
+  @param element The element to push, or the first element of a chain.
+  @param next The next pointer of the element, or of the last element in
+  the chain. It will be updated.
+*/
+static inline void CR_AtomicPush(void **head, void *element, void **next)
+{
+#ifdef CREGION_HAVE_ATOMICS
+  *next = __atomic_load_n(head, __ATOMIC_RELAXED);
+  while(!__atomic_compare_exchange_n(head, next, element, true,
+                                     __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+#else
+  *next = *head;
+  *head = element;
+#endif
+}
+
+/** Atomically takes all elements from a list filled by CR_AtomicPush().
+
+  @param head The first element of the list, which will be set to NULL.
+
+  @return The first element of the list or NULL.
+*/
+static inline void *CR_AtomicTakeAll(void **head)
+{
+#ifdef CREGION_HAVE_ATOMICS
+  if(__atomic_load_n(head, __ATOMIC_RELAXED) == NULL)
+  {
+    return NULL;
+  }
+  return __atomic_exchange_n(head, NULL, __ATOMIC_ACQUIRE);
+#else
+  void *elements = *head;
+  *head = NULL;
+  return elements;
+#endif
+}
+
+#endif
@@ -0,0 +1,310 @@
+/** @file
+  Implements a process-wide cache of memory chunks, which allows regions
+  to reuse chunks without going through malloc() and free().
+*/
+
+#include "chunk-cache.h"
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "address-sanitizer.h"
+#include "atomics.h"
+#include "error-handling.h"
+#include "page-alloc.h"
+
+/** The size of the smallest cacheable chunk. Only chunks which have a
+  power of two size of at least this value are cacheable. */
+#define min_chunk_size 1024
+#define min_chunk_size_log2 10
+
+/** The amount of size classes. Class n contains chunks with a size of
+  min_chunk_size * 2^n bytes. */
+#define size_class_count (sizeof(size_t) * CHAR_BIT - min_chunk_size_log2)
+
+/** The amount of bytes each size class may hold by default. */
+#define default_class_capacity (1024 * 1024)
+
+/** A cached chunk. It is stored at the beginning of the chunk itself. */
+typedef struct CachedChunk CachedChunk;
+struct CachedChunk
+{
+  CachedChunk *next;
+};
+
+/** A list of cached chunks with the same size. */
+typedef struct
+{
+  CachedChunk *chunks; /**< The cached chunks. */
+  size_t count; /**< The amount of cached chunks. */
+  size_t limit; /**< The maximum amount of cached chunks. */
+}SizeClass;
+
+static SizeClass size_classes[size_class_count];
+
+/** Like size_classes, but for chunks which are aligned to their own size
+  and allocated via CR_PageAllocAligned(). */
+static SizeClass aligned_size_classes[size_class_count];
+
+/** Protects aligned_size_classes, which get accessed by thread-safe
+  memory pools. */
+static CR_Spinlock aligned_lock = 0;
+
+/** Initializes the limits of all size classes the first time this
+  function is called. */
+static void ensureCacheIsInitialized(void)
+{
+  static bool initialized = false;
+  if(initialized == true)
+  {
+    return;
+  }
+
+  for(size_t index = 0; index < size_class_count; index++)
+  {
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+    size_classes[index].limit = 0;
+#else
+    const size_t chunk_size = (size_t)min_chunk_size << index;
+    size_classes[index].limit = default_class_capacity / chunk_size;
+#endif
+    aligned_size_classes[index].limit = size_classes[index].limit;
+  }
+
+  initialized = true;
+}
+
+/** Returns the size class of the given chunk size.
+
+  @param size The size of a chunk.
+
+  @return The size class, or NULL if chunks with the given size can not be
+  cached.
+*/
+static SizeClass *getSizeClass(size_t size)
+{
+  if(size < min_chunk_size || (size & (size - 1)) != 0)
+  {
+    return NULL;
+  }
+
+  ensureCacheIsInitialized();
+
+  size_t index = 0;
+  for(size_t class_size = min_chunk_size; class_size < size; class_size <<= 1)
+  {
+    index++;
+  }
+
+  return &size_classes[index];
+}
+
+/** Returns the aligned counterpart of the given size class. */
+static SizeClass *getAlignedSizeClass(SizeClass *size_class)
+{
+  return size_class == NULL ? NULL :
+    &aligned_size_classes[size_class - size_classes];
+}
+
+/** Frees the given amount of chunks from the specified size class of
+  aligned chunks. The lock for aligned chunks must be held. */
+static void freeAlignedChunks(SizeClass *size_class, size_t count)
+{
+  const size_t size =
+    (size_t)min_chunk_size << (size_class - aligned_size_classes);
+  for(size_t counter = 0; counter < count; counter++)
+  {
+    CachedChunk *chunk = size_class->chunks;
+    ASAN_UNPOISON_MEMORY_REGION(chunk, size);
+
+    size_class->chunks = chunk->next;
+    size_class->count--;
+    CR_PageFree(chunk, size);
+  }
+}
+
+/** Frees the given amount of chunks from the specified size class. */
+static void freeChunks(SizeClass *size_class, size_t count)
+{
+  for(size_t counter = 0; counter < count; counter++)
+  {
+    CachedChunk *chunk = size_class->chunks;
+    ASAN_UNPOISON_MEMORY_REGION(chunk, sizeof *chunk);
+
+    size_class->chunks = chunk->next;
+    size_class->count--;
+    free(chunk);
+  }
+}
+
+/** Returns a chunk from the cache or allocates a new one. Chunks which
+  have a size of 2^n bytes and are not smaller than 1024 bytes are
+  cacheable. Other chunks will always be allocated via malloc().
+
+  @param size The size of the chunk.
+
+  @return A chunk with the given size, which should be passed to
+  CR_ChunkCacheFree(). Will never be NULL.
+*/
+void *CR_ChunkCacheAlloc(size_t size)
+{
+  SizeClass *size_class = getSizeClass(size);
+  if(size_class != NULL && size_class->chunks != NULL)
+  {
+    CachedChunk *chunk = size_class->chunks;
+    ASAN_UNPOISON_MEMORY_REGION(chunk, size);
+
+    size_class->chunks = chunk->next;
+    size_class->count--;
+    return chunk;
+  }
+
+  void *chunk = malloc(size);
+  if(chunk == NULL)
+  {
+    /* Retry after returning all cached chunks to the system. */
+    CR_ChunkCacheTrim();
+    chunk = malloc(size);
+  }
+  if(chunk == NULL)
+  {
+    CR_ExitFailure("failed to allocate %zu bytes", size);
+  }
+
+  return chunk;
+}
+
+/** Returns the given chunk to the cache. If the cache is full or the chunk
+  is not cacheable, it will be freed.
+
+  @param chunk A chunk returned by CR_ChunkCacheAlloc().
+  @param size The size of the chunk.
+*/
+void CR_ChunkCacheFree(void *chunk, size_t size)
+{
+  SizeClass *size_class = getSizeClass(size);
+  if(size_class == NULL || size_class->count >= size_class->limit)
+  {
+    free(chunk);
+    return;
+  }
+
+  CachedChunk *cached_chunk = chunk;
+  cached_chunk->next = size_class->chunks;
+  size_class->chunks = cached_chunk;
+  size_class->count++;
+
+  ASAN_POISON_MEMORY_REGION(chunk, size);
+}
+
+/** Like CR_ChunkCacheAlloc(), but returns a chunk which is aligned to its
+  own size. Unlike other functions of the cache, this function can be
+  called from multiple threads.
+
+  @param size The size of the chunk. Must be a power of two.
+
+  @return A chunk with the given size, which should be passed to
+  CR_ChunkCacheFreeAligned(). Will never be NULL.
+*/
+void *CR_ChunkCacheAllocAligned(size_t size)
+{
+  CR_SpinlockAcquire(&aligned_lock);
+  SizeClass *size_class = getAlignedSizeClass(getSizeClass(size));
+  if(size_class != NULL && size_class->chunks != NULL)
+  {
+    CachedChunk *chunk = size_class->chunks;
+    ASAN_UNPOISON_MEMORY_REGION(chunk, size);
+
+    size_class->chunks = chunk->next;
+    size_class->count--;
+    CR_SpinlockRelease(&aligned_lock);
+    return chunk;
+  }
+  CR_SpinlockRelease(&aligned_lock);
+
+  return CR_PageAllocAligned(size, size);
+}
+
+/** Returns the given aligned chunk to the cache. If the cache is full, it
+  will be returned to the system.
+
+  @param chunk A chunk returned by CR_ChunkCacheAllocAligned().
+  @param size The size of the chunk.
+*/
+void CR_ChunkCacheFreeAligned(void *chunk, size_t size)
+{
+  CR_SpinlockAcquire(&aligned_lock);
+  SizeClass *size_class = getAlignedSizeClass(getSizeClass(size));
+  if(size_class == NULL || size_class->count >= size_class->limit)
+  {
+    CR_SpinlockRelease(&aligned_lock);
+    CR_PageFree(chunk, size);
+    return;
+  }
+
+  CachedChunk *cached_chunk = chunk;
+  cached_chunk->next = size_class->chunks;
+  size_class->chunks = cached_chunk;
+  size_class->count++;
+
+  ASAN_POISON_MEMORY_REGION(chunk, size);
+  CR_SpinlockRelease(&aligned_lock);
+}
+
+/** Sets the maximum amount of chunks with the given size which the cache
+  may hold. By default each size class holds up to 1 MiB. Chunks returned
+  by CR_ChunkCacheAllocAligned() are limited separately, but to the same
+  amount.
+
+  @param chunk_size The size of the chunks. Must be a power of two and
+  not smaller than 1024.
+  @param limit The maximum amount of cached chunks. If the cache contains
+  more chunks, they will be freed.
+*/
+void CR_ChunkCacheSetLimit(size_t chunk_size, size_t limit)
+{
+  SizeClass *size_class = getSizeClass(chunk_size);
+  if(size_class == NULL)
+  {
+    CR_ExitFailure("unable to cache chunks of %zu bytes", chunk_size);
+  }
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  size_class->limit = limit;
+#else
+  (void)limit;
+#endif
+
+  if(size_class->count > size_class->limit)
+  {
+    freeChunks(size_class, size_class->count - size_class->limit);
+  }
+
+  CR_SpinlockAcquire(&aligned_lock);
+  SizeClass *aligned_size_class = getAlignedSizeClass(size_class);
+  aligned_size_class->limit = size_class->limit;
+  if(aligned_size_class->count > aligned_size_class->limit)
+  {
+    freeAlignedChunks(aligned_size_class,
+                      aligned_size_class->count - aligned_size_class->limit);
+  }
+  CR_SpinlockRelease(&aligned_lock);
+}
+
+/** Frees all chunks in the cache. */
+void CR_ChunkCacheTrim(void)
+{
+  for(size_t index = 0; index < size_class_count; index++)
+  {
+    freeChunks(&size_classes[index], size_classes[index].count);
+  }
+
+  CR_SpinlockAcquire(&aligned_lock);
+  for(size_t index = 0; index < size_class_count; index++)
+  {
+    freeAlignedChunks(&aligned_size_classes[index],
+                      aligned_size_classes[index].count);
+  }
+  CR_SpinlockRelease(&aligned_lock);
+}
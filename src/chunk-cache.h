@@ -0,0 +1,17 @@
+/** @file
+  Declares functions for recycling memory chunks between regions.
+*/
+
+#ifndef CREGION_SRC_CHUNK_CACHE_H
+#define CREGION_SRC_CHUNK_CACHE_H
+
+#include <stddef.h>
+
+extern void *CR_ChunkCacheAlloc(size_t size);
+extern void CR_ChunkCacheFree(void *chunk, size_t size);
+extern void *CR_ChunkCacheAllocAligned(size_t size);
+extern void CR_ChunkCacheFreeAligned(void *chunk, size_t size);
+extern void CR_ChunkCacheSetLimit(size_t chunk_size, size_t limit);
+extern void CR_ChunkCacheTrim(void);
+
+#endif
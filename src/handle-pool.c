@@ -0,0 +1,259 @@
+/** @file
+  Implements a pool which stores its objects densely and references them
+  via handles.
+*/
+
+#include "handle-pool.h"
+
+#include <string.h>
+
+#include "alloc-growable.h"
+#include "error-handling.h"
+#include "safe-math.h"
+
+/** The amount of bits in a handle used for the slot index. The remaining
+  bits store the generation. */
+#define index_bits 20
+
+/** The maximal amount of objects in a pool. */
+#define max_objects ((uint32_t)1 << index_bits)
+
+/** The amount of objects for which memory gets allocated initially. */
+#define initial_capacity 16
+
+/** Marks the end of the free slot list. */
+#define no_slot UINT32_MAX
+
+/** Maps a handle to an object in the dense object array. */
+typedef struct
+{
+  /** The generation of the object occupying this slot. It gets
+    incremented when the object is destroyed. Never zero. */
+  uint32_t generation;
+
+  /** The index of the object in the dense array, or the next free slot if
+    this slot is unused. */
+  uint32_t index;
+}Slot;
+
+struct CR_HandlePool
+{
+  /** The size of each object. */
+  size_t object_size;
+
+  /** All objects, stored without gaps. */
+  unsigned char *objects;
+
+  /** The slot of each object in the dense array. */
+  uint32_t *object_slots;
+
+  /** All slots ever used by the pool. */
+  Slot *slots;
+
+  /** The amount of objects in the pool and the amount of objects fitting
+    into the arrays above. */
+  uint32_t count;
+  uint32_t capacity;
+
+  /** The amount of slots in use or in the free slot list. */
+  uint32_t slot_count;
+
+  /** The first unused slot. */
+  uint32_t free_slot;
+};
+
+/** Returns the slot index stored in the given handle. */
+static uint32_t getSlotIndex(CR_Handle handle)
+{
+  return handle & (max_objects - 1);
+}
+
+/** Returns the generation stored in the given handle. */
+static uint32_t getGeneration(CR_Handle handle)
+{
+  return handle >> index_bits;
+}
+
+/** Returns the slot referenced by the given handle or NULL, if the handle
+  is invalid. */
+static Slot *getSlot(CR_HandlePool *pool, CR_Handle handle)
+{
+  const uint32_t slot_index = getSlotIndex(handle);
+  if(slot_index >= pool->slot_count)
+  {
+    return NULL;
+  }
+
+  Slot *slot = &pool->slots[slot_index];
+  if(slot->generation != getGeneration(handle))
+  {
+    return NULL;
+  }
+
+  return slot;
+}
+
+/** Creates a new handle pool.
+
+  @param r The region to which the pool should be bound.
+  @param object_size The size of each object. Objects are stored directly
+  after each other, so their size must be a multiple of their alignment.
+
+  @return A pool bound to the lifetime of the given region.
+*/
+CR_HandlePool *CR_HandlePoolNew(CR_Region *r, size_t object_size)
+{
+  if(object_size == 0)
+  {
+    CR_ExitFailure("unable to create handle pool for allocating zero size objects");
+  }
+
+  CR_HandlePool *pool = CR_RegionAlloc(r, sizeof *pool);
+  pool->object_size = object_size;
+  pool->objects =
+    CR_RegionAllocGrowable(r, CR_SafeMultiply(object_size, initial_capacity));
+  pool->object_slots =
+    CR_RegionAllocGrowable(r, sizeof(uint32_t) * initial_capacity);
+  pool->slots = CR_RegionAllocGrowable(r, sizeof(Slot) * initial_capacity);
+  pool->count = 0;
+  pool->capacity = initial_capacity;
+  pool->slot_count = 0;
+  pool->free_slot = no_slot;
+
+  return pool;
+}
+
+/** Allocates an object from the given pool.
+
+  @param pool The pool to allocate from.
+
+  @return A handle to an uninitialized object. It can be accessed via
+  CR_HandlePoolGet().
+*/
+CR_Handle CR_HandlePoolAlloc(CR_HandlePool *pool)
+{
+  if(pool->count == pool->capacity)
+  {
+    if(pool->capacity == max_objects)
+    {
+      CR_ExitFailure("handle pool can not hold more than %zu objects",
+                     (size_t)max_objects);
+    }
+
+    pool->capacity *= 2;
+    pool->objects = CR_EnsureCapacity(
+      pool->objects, CR_SafeMultiply(pool->object_size, pool->capacity));
+    pool->object_slots = CR_EnsureCapacity(
+      pool->object_slots, sizeof(uint32_t) * pool->capacity);
+    pool->slots =
+      CR_EnsureCapacity(pool->slots, sizeof(Slot) * pool->capacity);
+  }
+
+  uint32_t slot_index = pool->free_slot;
+  if(slot_index != no_slot)
+  {
+    pool->free_slot = pool->slots[slot_index].index;
+  }
+  else
+  {
+    slot_index = pool->slot_count;
+    pool->slot_count++;
+    pool->slots[slot_index].generation = 1;
+  }
+
+  Slot *slot = &pool->slots[slot_index];
+  slot->index = pool->count;
+  pool->object_slots[pool->count] = slot_index;
+  pool->count++;
+
+  return (slot->generation << index_bits) | slot_index;
+}
+
+/** Returns the object referenced by the given handle. The returned pointer
+  will be invalidated by allocating or destroying objects in the pool.
+
+  @param pool The pool containing the object.
+  @param handle A handle returned by CR_HandlePoolAlloc().
+
+  @return The object or NULL if the handle is invalid or its object was
+  destroyed.
+*/
+void *CR_HandlePoolGet(CR_HandlePool *pool, CR_Handle handle)
+{
+  Slot *slot = getSlot(pool, handle);
+  if(slot == NULL)
+  {
+    return NULL;
+  }
+
+  return &pool->objects[slot->index * pool->object_size];
+}
+
+/** Destroys the object referenced by the given handle. To keep all objects
+  continuous, the last object in the pool gets moved into its place.
+
+  @param pool The pool containing the object.
+  @param handle A handle returned by CR_HandlePoolAlloc().
+*/
+void CR_HandlePoolDestroy(CR_HandlePool *pool, CR_Handle handle)
+{
+  Slot *slot = getSlot(pool, handle);
+  if(slot == NULL)
+  {
+    CR_ExitFailure("passed invalid handle to CR_HandlePoolDestroy()");
+  }
+
+  const uint32_t last_index = pool->count - 1;
+  if(slot->index != last_index)
+  {
+    memcpy(&pool->objects[slot->index * pool->object_size],
+           &pool->objects[last_index * pool->object_size],
+           pool->object_size);
+
+    const uint32_t moved_slot = pool->object_slots[last_index];
+    pool->object_slots[slot->index] = moved_slot;
+    pool->slots[moved_slot].index = slot->index;
+  }
+  pool->count--;
+
+  /* Invalidate all handles to this slot. Zero is reserved. */
+  slot->generation = (slot->generation + 1) & ((UINT32_MAX >> index_bits));
+  if(slot->generation == 0)
+  {
+    slot->generation = 1;
+  }
+
+  slot->index = pool->free_slot;
+  pool->free_slot = getSlotIndex(handle);
+}
+
+/** Returns the amount of objects in the given pool. */
+size_t CR_HandlePoolCount(CR_HandlePool *pool)
+{
+  return pool->count;
+}
+
+/** Returns the array containing all objects in the given pool. It has
+  CR_HandlePoolCount() elements and will be invalidated by allocating or
+  destroying objects.
+*/
+void *CR_HandlePoolObjects(CR_HandlePool *pool)
+{
+  return pool->objects;
+}
+
+/** Returns the handle of the object at the given index in the array
+  returned by CR_HandlePoolObjects(). The index must be smaller than
+  CR_HandlePoolCount().
+*/
+CR_Handle CR_HandlePoolHandleAt(CR_HandlePool *pool, size_t index)
+{
+  if(index >= pool->count)
+  {
+    CR_ExitFailure("index %zu is out of range in handle pool with %zu objects",
+                   index, (size_t)pool->count);
+  }
+
+  const uint32_t slot_index = pool->object_slots[index];
+  return (pool->slots[slot_index].generation << index_bits) | slot_index;
+}
@@ -0,0 +1,29 @@
+/** @file
+  Declares functions for storing objects densely and referencing them via
+  handles.
+*/
+
+#ifndef CREGION_SRC_HANDLE_POOL_H
+#define CREGION_SRC_HANDLE_POOL_H
+
+#include <stdint.h>
+
+#include "region.h"
+
+/** A pool which stores its objects in one continuous array. */
+typedef struct CR_HandlePool CR_HandlePool;
+
+/** A reference to an object in a handle pool, consisting of a slot index
+  and a generation. Handles to destroyed objects are detected, until the
+  generation of their slot wraps around. Zero is never a valid handle. */
+typedef uint32_t CR_Handle;
+
+extern CR_HandlePool *CR_HandlePoolNew(CR_Region *r, size_t object_size);
+extern CR_Handle CR_HandlePoolAlloc(CR_HandlePool *pool);
+extern void *CR_HandlePoolGet(CR_HandlePool *pool, CR_Handle handle);
+extern void CR_HandlePoolDestroy(CR_HandlePool *pool, CR_Handle handle);
+extern size_t CR_HandlePoolCount(CR_HandlePool *pool);
+extern void *CR_HandlePoolObjects(CR_HandlePool *pool);
+extern CR_Handle CR_HandlePoolHandleAt(CR_HandlePool *pool, size_t index);
+
+#endif
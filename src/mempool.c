@@ -1,16 +1,34 @@
 /** @file
   Implements a memory pool for reusing memory allocated from regions.
+  Objects are carved from slabs, which are allocated directly from the
+  operating system and keep objects of the same pool close together.
+  Objects of pools without destructors have no header, and are found via
+  the slab containing them.
 */
 
 #include "mempool.h"
 
+#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "address-sanitizer.h"
+#include "atomics.h"
+#include "chunk-cache.h"
 #include "error-handling.h"
+#include "page-alloc.h"
 #include "safe-math.h"
 #include "static-assert.h"
 
+/** The size of a slab. Pools with objects which don't fit into a slab of
+  this size allocate one object per slab. */
+#define default_slab_size (64 * 1024)
+
+/** The minimal alignment of objects. */
+#define min_alignment 8
+
 /** Contains the state of a destructor. */
 typedef enum
 {
@@ -33,6 +51,77 @@ struct Header
   Header *prev, *next;
 };
 
+/** A destroyed object without header, which is ready for reuse. */
+typedef struct FreeObject FreeObject;
+struct FreeObject
+{
+  FreeObject *next;
+};
+
+/** An object destroyed by a thread other than the owner of its mempool. */
+typedef struct
+{
+  /** The next object, updated via atomic operations. */
+  void *next;
+}RemoteObject;
+
+/** A block of memory from which a mempool carves its objects. It is
+  stored at the beginning of the slab itself and aligned to the default
+  slab size. */
+typedef struct Slab Slab;
+struct Slab
+{
+  /** The memory pool to which this slab belongs. */
+  CR_Mempool *mp;
+
+  /** The previous and next slabs of the same pool. */
+  Slab *prev, *next;
+
+  /** The amount of allocated objects in this slab. Objects kept by
+    magazines count as allocated. */
+  size_t live_objects;
+
+  /** Contains one bit for each possible object address in the first
+    default_slab_size bytes of the slab. A bit is set if the object
+    starting at this address is currently allocated. */
+  unsigned char allocated_objects[default_slab_size / min_alignment /
+                                  CHAR_BIT];
+};
+
+/** The amount of objects each magazine can hold. */
+#define magazine_size 64
+
+/** A stack of free objects, which gets exchanged between the caches of a
+  thread-safe mempool and its depot. */
+typedef struct Magazine Magazine;
+struct Magazine
+{
+  /** The next magazine in the depot. */
+  Magazine *next;
+
+  /** The amount of objects in the magazine. */
+  size_t count;
+
+  /** The objects in the magazine, poisoned for ASAN. */
+  void *objects[magazine_size];
+};
+
+/** A cache of free objects used by a single thread. */
+struct CR_MempoolCache
+{
+  /** The mempool to which the cache belongs. */
+  CR_Mempool *mp;
+
+  /** The magazine from which objects get allocated and the magazine which
+    gets swapped in when it is empty or full. This avoids exchanging
+    magazines with the depot on every switch between allocating and
+    destroying. */
+  Magazine *loaded, *previous;
+
+  /** The next cache of the same mempool. */
+  CR_MempoolCache *next;
+};
+
 /** A memory pool for reusing allocated memory. */
 struct CR_Mempool
 {
@@ -47,43 +136,192 @@ struct CR_Mempool
     released. */
   CR_ReleaseCallback *implicit_destructor;
 
-  /** The size of an object + header. */
+  /** The size of an object + header. Objects without header are at least
+    as large as a FreeObject. */
   size_t chunk_size;
 
+  /** True if objects have a header. This is the case if the pool has
+    destructors. */
+  bool has_headers;
+
+  /** The boundary to which objects are aligned. */
+  size_t alignment;
+
+  /** The amount of padding bytes in front of each header, required to
+    align the object following it. */
+  size_t header_offset;
+
   /** A list of all allocated chunks. Required for releasing them. */
   Header *allocated_chunks;
 
   /** A list of explicitly destroyed chunks ready for reuse. */
   Header *released_chunks;
+
+  /** Like released_chunks, but for objects without header. */
+  FreeObject *free_objects;
+
+  /** The size of each slab. */
+  size_t slab_size;
+
+  /** The offset of the first chunk in a slab. */
+  size_t first_chunk_offset;
+
+  /** The distance between two chunks in a slab. */
+  size_t chunk_stride;
+
+  /** The amount of chunks carved from each slab. */
+  size_t chunks_per_slab;
+
+  /** All slabs owned by this mempool. The first slab is the one from
+    which new chunks get carved. */
+  Slab *slabs;
+
+  /** Unused slabs recycled by CR_MempoolClear(). Only linked via their
+    next pointers. */
+  Slab *spare_slabs;
+
+  /** The next uncarved chunk in the first slab and the amount of chunks
+    left after it. */
+  unsigned char *next_chunk;
+  size_t chunks_left;
+
+  /** True if the mempool can be shared between threads. All members of
+    this struct are then protected by its lock, except for the ones which
+    never change. */
+  bool thread_safe;
+  CR_Spinlock lock;
+
+  /** The depot of thread-safe pools, which contains full magazines
+    waiting to be used by caches and empty ones for reuse. */
+  Magazine *full_magazines, *empty_magazines;
+
+  /** All caches created for this pool. */
+  CR_MempoolCache *caches;
+
+  /** The thread which created a pool with the remote_destroy option, or
+    NULL. */
+  const void *owner;
+
+  /** Objects without header destroyed by threads other than the owner.
+    They get pushed atomically and will be moved to free_objects by the
+    owner once it runs out of free objects. */
+  void *remote_objects;
 };
 
 #ifdef CREGION_ALWAYS_FRESH_MALLOC
-#include <stdlib.h>
+/** Allocates a chunk using malloc(). The pointer returned by malloc() will
+  be stored in front of the header, to allow aligning the object.
+
+  @param mp The mempool for which the chunk should be allocated.
+
+  @return The header of the chunk.
+*/
+static Header *mallocChunk(CR_Mempool *mp)
+{
+  const size_t size = CR_SafeAdd(mp->chunk_size,
+                                 mp->alignment - 1 + sizeof(void *));
+
+  unsigned char *data = malloc(size);
+  if(data == NULL)
+  {
+    CR_ExitFailure("failed to allocate %zu bytes", size);
+  }
+
+  uintptr_t object = (uintptr_t)&data[sizeof(void *) + sizeof(Header)];
+  object = (object + mp->alignment - 1) & ~(uintptr_t)(mp->alignment - 1);
+
+  Header *header = (Header *)object - 1;
+  ((void **)header)[-1] = data;
+
+  return header;
+}
+
+/** Frees a chunk allocated by mallocChunk(). */
+static void freeChunk(Header *header)
+{
+  free(((void **)header)[-1]);
+}
+
+#endif
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+/** Returns the given slab to the chunk cache, or to the system if it is
+  larger than the default slab size. */
+static void releaseSlab(CR_Mempool *mp, Slab *slab)
+{
+  ASAN_UNPOISON_MEMORY_REGION(slab, mp->slab_size);
+  if(mp->slab_size == default_slab_size)
+  {
+    CR_ChunkCacheFreeAligned(slab, default_slab_size);
+  }
+  else
+  {
+    CR_PageFree(slab, mp->slab_size);
+  }
+}
+#endif
 
-/** Free all chunks allocated by the given mempool. */
-static void FREE_ALL_CHUNKS_IF_REQUIRED(CR_Mempool *mp)
+/** Frees all chunks allocated by the given mempool. */
+static void freeAllChunks(CR_Mempool *mp)
 {
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
   Header *header = mp->allocated_chunks;
   while(header != NULL)
   {
     ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
     Header *next = header->next;
-    free(header);
+    freeChunk(header);
     header = next;
   }
-}
 #else
-#define FREE_ALL_CHUNKS_IF_REQUIRED(mp) ((void)(mp))
+  Slab *lists[] = { mp->slabs, mp->spare_slabs };
+  for(size_t index = 0; index < 2; index++)
+  {
+    Slab *slab = lists[index];
+    while(slab != NULL)
+    {
+      Slab *next = slab->next;
+      releaseSlab(mp, slab);
+      slab = next;
+    }
+  }
 #endif
+}
 
-/** Destroys all objects in the given mempool using the implicit
-  destructor. */
-static void destroyObjects(void *data)
+/** Frees the given list of magazines. */
+static void freeMagazines(Magazine *magazine)
+{
+  while(magazine != NULL)
+  {
+    Magazine *next = magazine->next;
+    free(magazine);
+    magazine = next;
+  }
+}
+
+/** Frees all caches and magazines of the given mempool. */
+static void freeCaches(CR_Mempool *mp)
+{
+  CR_MempoolCache *cache = mp->caches;
+  while(cache != NULL)
+  {
+    CR_MempoolCache *next = cache->next;
+    free(cache->loaded);
+    free(cache->previous);
+    free(cache);
+    cache = next;
+  }
+
+  freeMagazines(mp->full_magazines);
+  freeMagazines(mp->empty_magazines);
+}
+
+/** Passes all objects of the given mempool with an enabled destructor to
+  the implicit destructor. */
+static void callImplicitDestructors(CR_Mempool *mp)
 {
-  CR_Mempool *mp = data;
   if(mp->implicit_destructor == NULL)
   {
-    FREE_ALL_CHUNKS_IF_REQUIRED(mp);
     return;
   }
 
@@ -98,8 +336,16 @@ static void destroyObjects(void *data)
       ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
     }
   }
+}
 
-  FREE_ALL_CHUNKS_IF_REQUIRED(mp);
+/** Destroys all objects in the given mempool using the implicit
+  destructor. */
+static void destroyObjects(void *data)
+{
+  CR_Mempool *mp = data;
+  freeCaches(mp);
+  callImplicitDestructors(mp);
+  freeAllChunks(mp);
 }
 
 /** Creates a new mempool.
@@ -122,25 +368,230 @@ static void destroyObjects(void *data)
 CR_Mempool *CR_MempoolNew(CR_Region *r, size_t object_size,
                           CR_FailableDestructor *explicit_destructor,
                           CR_ReleaseCallback *implicit_destructor)
+{
+  static const CR_MempoolOptions default_options;
+  return CR_MempoolNewWithOptions(r, object_size, explicit_destructor,
+                                  implicit_destructor, &default_options);
+}
+
+/** Like CR_MempoolNew(), but takes additional options.
+
+  @param options The options to use. Members which are zero will be
+  replaced by their defaults. See CR_MempoolOptions for details.
+*/
+CR_Mempool *CR_MempoolNewWithOptions(CR_Region *r, size_t object_size,
+                                     CR_FailableDestructor *explicit_destructor,
+                                     CR_ReleaseCallback *implicit_destructor,
+                                     const CR_MempoolOptions *options)
 {
   if(object_size == 0)
   {
     CR_ExitFailure("unable to create memory pool for allocating zero size objects");
   }
-  CR_StaticAssert(sizeof(Header) % 8 == 0);
+  CR_StaticAssert(sizeof(Header) % min_alignment == 0);
+  CR_StaticAssert(default_slab_size % (min_alignment * CHAR_BIT) == 0);
+
+  const size_t alignment = options->alignment < min_alignment ?
+    min_alignment : options->alignment;
+  if((alignment & (alignment - 1)) != 0 || alignment > 4096)
+  {
+    CR_ExitFailure("unable to align memory to %zu bytes", alignment);
+  }
+
+  if(options->thread_safe && options->remote_destroy)
+  {
+    CR_ExitFailure("thread-safe memory pools can not have the remote_destroy option");
+  }
+  if(options->thread_safe || options->remote_destroy)
+  {
+#ifndef CREGION_HAVE_ATOMICS
+    CR_ExitFailure("thread-safe memory pools are not supported by this compiler");
+#endif
+    if(explicit_destructor != NULL || implicit_destructor != NULL)
+    {
+      CR_ExitFailure("thread-safe memory pools can not have destructors");
+    }
+  }
+
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  const bool has_headers = true;
+#else
+  const bool has_headers =
+    explicit_destructor != NULL || implicit_destructor != NULL;
+#endif
+
+  /* Pad the header, so that the object following it is aligned. */
+  size_t header_offset = 0;
+  size_t chunk_size = object_size < sizeof(FreeObject) ?
+    sizeof(FreeObject) : object_size;
+  if(has_headers)
+  {
+    header_offset =
+      (alignment - (sizeof(Header) & (alignment - 1))) & (alignment - 1);
+    chunk_size = CR_SafeAdd(sizeof(Header), object_size);
+  }
+
+  /* Chunks follow each other directly, so each of them must be padded to
+     keep the next one aligned. */
+  const size_t padded_chunk_size = CR_SafeAdd(header_offset, chunk_size);
+  const size_t chunk_stride =
+    CR_SafeAdd(padded_chunk_size, alignment - 1) & ~(alignment - 1);
+  const size_t first_chunk_offset =
+    (sizeof(Slab) + alignment - 1) & ~(alignment - 1);
+
+  /* Slabs are multiples of the default slab size, to allow finding them
+     by masking. */
+  size_t slab_size = default_slab_size;
+  if(chunk_stride > slab_size - first_chunk_offset)
+  {
+    slab_size = CR_SafeAdd(CR_SafeAdd(first_chunk_offset, chunk_stride),
+                           default_slab_size - 1) &
+      ~(size_t)(default_slab_size - 1);
+  }
+
+  /* Objects are found by masking their address, so only the chunk
+     starting in the first default_slab_size bytes of an enlarged slab can
+     be used. */
+  const size_t chunks_per_slab = slab_size > default_slab_size ? 1 :
+    (slab_size - first_chunk_offset) / chunk_stride;
 
   CR_Mempool *mp = CR_RegionAlloc(r, sizeof *mp);
   mp->r = r;
   mp->explicit_destructor = explicit_destructor;
   mp->implicit_destructor = implicit_destructor;
-  mp->chunk_size = CR_SafeAdd(sizeof(Header), object_size);
+  mp->chunk_size = chunk_size;
+  mp->has_headers = has_headers;
+  mp->alignment = alignment;
+  mp->header_offset = header_offset;
   mp->allocated_chunks = NULL;
   mp->released_chunks = NULL;
+  mp->free_objects = NULL;
+  mp->slab_size = slab_size;
+  mp->first_chunk_offset = first_chunk_offset;
+  mp->chunk_stride = chunk_stride;
+  mp->chunks_per_slab = chunks_per_slab;
+  mp->slabs = NULL;
+  mp->spare_slabs = NULL;
+  mp->next_chunk = NULL;
+  mp->chunks_left = 0;
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  /* Chunks with headers can't be destroyed without locking. */
+  mp->thread_safe = options->thread_safe || options->remote_destroy;
+  mp->owner = NULL;
+#else
+  mp->thread_safe = options->thread_safe;
+  mp->owner = options->remote_destroy ? CR_GetThreadId() : NULL;
+#endif
+  mp->lock = 0;
+  mp->full_magazines = NULL;
+  mp->empty_magazines = NULL;
+  mp->caches = NULL;
+  mp->remote_objects = NULL;
   CR_RegionAttach(r, destroyObjects, mp);
 
   return mp;
 }
 
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+/** Returns the slab containing the given object. */
+static Slab *getSlab(void *ptr)
+{
+  return (Slab *)((uintptr_t)ptr & ~(uintptr_t)(default_slab_size - 1));
+}
+
+/** Returns the index of the bit in the slabs allocated_objects array,
+  which belongs to the given object. */
+static size_t getObjectBit(Slab *slab, void *ptr)
+{
+  return (size_t)((unsigned char *)ptr - (unsigned char *)slab) /
+    min_alignment;
+}
+
+/** Returns true if the given object in the specified slab is allocated. */
+static bool isAllocated(Slab *slab, void *ptr)
+{
+  const size_t bit = getObjectBit(slab, ptr);
+  return (slab->allocated_objects[bit / CHAR_BIT] >> (bit % CHAR_BIT)) & 1;
+}
+
+/** Marks the given object in the specified slab as allocated or free. */
+static void setAllocated(Slab *slab, void *ptr, bool allocated)
+{
+  const size_t bit = getObjectBit(slab, ptr);
+  const unsigned char mask = (unsigned char)(1 << (bit % CHAR_BIT));
+  if(allocated)
+  {
+    slab->allocated_objects[bit / CHAR_BIT] |= mask;
+    slab->live_objects++;
+  }
+  else
+  {
+    slab->allocated_objects[bit / CHAR_BIT] &= (unsigned char)~mask;
+    slab->live_objects--;
+  }
+}
+
+/** Maps a new, empty slab for the given mempool. Slabs of the default
+  size come from the chunk cache, which avoids mapping pages for pools in
+  short-lived regions. */
+static Slab *newSlab(CR_Mempool *mp)
+{
+  Slab *slab = mp->slab_size == default_slab_size ?
+    CR_ChunkCacheAllocAligned(default_slab_size) :
+    CR_PageAllocAligned(mp->slab_size, default_slab_size);
+  slab->mp = mp;
+  slab->live_objects = 0;
+  memset(slab->allocated_objects, 0, sizeof(slab->allocated_objects));
+
+  return slab;
+}
+
+/** Allocates a new slab and makes it the slab from which chunks get
+  carved. */
+static void allocSlab(CR_Mempool *mp)
+{
+  Slab *slab = mp->spare_slabs;
+  if(slab != NULL)
+  {
+    mp->spare_slabs = slab->next;
+  }
+  else
+  {
+    slab = newSlab(mp);
+  }
+  slab->prev = NULL;
+  slab->next = mp->slabs;
+  if(mp->slabs != NULL)
+  {
+    mp->slabs->prev = slab;
+  }
+  mp->slabs = slab;
+
+  unsigned char *data = (unsigned char *)slab;
+  mp->next_chunk = &data[mp->first_chunk_offset];
+  mp->chunks_left = mp->chunks_per_slab;
+
+  ASAN_POISON_MEMORY_REGION(mp->next_chunk,
+                            mp->slab_size - mp->first_chunk_offset);
+}
+
+/** Carves a new chunk from the current slab of the given mempool. */
+static void *carveChunk(CR_Mempool *mp)
+{
+  if(mp->chunks_left == 0)
+  {
+    allocSlab(mp);
+  }
+
+  unsigned char *data = mp->next_chunk;
+  mp->next_chunk += mp->chunk_stride;
+  mp->chunks_left--;
+
+  ASAN_UNPOISON_MEMORY_REGION(data, mp->chunk_stride);
+  return &data[mp->header_offset];
+}
+#endif
+
 /** Returns the next reusable chunk. If no chunk exists, a new one will be
   allocated and returned.
 
@@ -151,17 +602,11 @@ CR_Mempool *CR_MempoolNew(CR_Region *r, size_t object_size,
 static void *getAvailableChunk(CR_Mempool *mp)
 {
 #ifdef CREGION_ALWAYS_FRESH_MALLOC
-  void *data = malloc(mp->chunk_size);
-  if(data == NULL)
-  {
-    CR_ExitFailure("failed to allocate %zu bytes", mp->chunk_size);
-  }
-
-  return data;
+  return mallocChunk(mp);
 #else
   if(mp->released_chunks == NULL)
   {
-    return CR_RegionAlloc(mp->r, mp->chunk_size);
+    return carveChunk(mp);
   }
   else
   {
@@ -181,14 +626,81 @@ static void *getAvailableChunk(CR_Mempool *mp)
 #endif
 }
 
-/** Allocates from the given mempool.
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+static bool destroyWithoutHeader(CR_Mempool *mp, Slab *slab, void *ptr);
 
-  @param mp The mempool to allocate from.
+/** Moves all objects destroyed by other threads into the free object list
+  of the given mempool. */
+static void takeRemoteObjects(CR_Mempool *mp)
+{
+  RemoteObject *object = CR_AtomicTakeAll(&mp->remote_objects);
+  while(object != NULL)
+  {
+    ASAN_UNPOISON_MEMORY_REGION(object, mp->chunk_size);
+    RemoteObject *next = object->next;
 
-  @return Uninitialized, reused memory.
+    if(!destroyWithoutHeader(mp, getSlab(object), object))
+    {
+      CR_ExitFailure("passed the same object to CR_DestroyObject() twice");
+    }
+    object = next;
+  }
+}
+
+/** Allocates an object without header from the given mempool. */
+static void *allocWithoutHeader(CR_Mempool *mp)
+{
+  if(mp->free_objects == NULL && mp->owner != NULL)
+  {
+    takeRemoteObjects(mp);
+  }
+
+  FreeObject *object = mp->free_objects;
+  if(object == NULL)
+  {
+    object = carveChunk(mp);
+  }
+  else
+  {
+    ASAN_UNPOISON_MEMORY_REGION(object, mp->chunk_size);
+    mp->free_objects = object->next;
+  }
+
+  setAllocated(getSlab(object), object, true);
+  return object;
+}
+
+/** Returns the given object without header to its mempool.
+
+  @return False if the object was already destroyed.
 */
-void *CR_MempoolAlloc(CR_Mempool *mp)
+static bool destroyWithoutHeader(CR_Mempool *mp, Slab *slab, void *ptr)
+{
+  if(!isAllocated(slab, ptr))
+  {
+    return false;
+  }
+  setAllocated(slab, ptr, false);
+
+  FreeObject *object = ptr;
+  object->next = mp->free_objects;
+  mp->free_objects = object;
+  ASAN_POISON_MEMORY_REGION(object, mp->chunk_size);
+
+  return true;
+}
+#endif
+
+/** Allocates an object from the given mempool, without locking it. */
+static void *allocObject(CR_Mempool *mp)
 {
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  if(!mp->has_headers)
+  {
+    return allocWithoutHeader(mp);
+  }
+#endif
+
   Header *header = getAvailableChunk(mp);
 
   header->destructor_state = DS_disabled;
@@ -206,10 +718,49 @@ void *CR_MempoolAlloc(CR_Mempool *mp)
     ASAN_POISON_MEMORY_REGION(header->next, sizeof(Header));
   }
 
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  setAllocated(getSlab(header + 1), header + 1, true);
+#endif
+
   ASAN_POISON_MEMORY_REGION(header, sizeof(Header));
   return header + 1;
 }
 
+/** Allocates from the given mempool.
+
+  @param mp The mempool to allocate from.
+
+  @return Uninitialized, reused memory.
+*/
+void *CR_MempoolAlloc(CR_Mempool *mp)
+{
+  if(!mp->thread_safe)
+  {
+    return allocObject(mp);
+  }
+
+  CR_SpinlockAcquire(&mp->lock);
+  void *object = allocObject(mp);
+  CR_SpinlockRelease(&mp->lock);
+
+  return object;
+}
+
+/** Returns the mempool to which the given object belongs. */
+static CR_Mempool *getMempool(void *ptr)
+{
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  Header *header = (Header *)ptr - 1;
+  ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
+  CR_Mempool *mp = header->mp;
+  ASAN_POISON_MEMORY_REGION(header, sizeof(Header));
+
+  return mp;
+#else
+  return getSlab(ptr)->mp;
+#endif
+}
+
 /** Enables the destructor of the given object. This is used to signalize
   that an object is fully initialized.
 
@@ -217,26 +768,36 @@ void *CR_MempoolAlloc(CR_Mempool *mp)
 */
 void CR_EnableObjectDestructor(void *ptr)
 {
+  if(!getMempool(ptr)->has_headers)
+  {
+    /* Objects without header have no destructors. */
+    return;
+  }
+
   Header *header = (Header *)ptr - 1;
   ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
   header->destructor_state = DS_enabled;
   ASAN_POISON_MEMORY_REGION(header, sizeof(Header));
 }
 
-/** Destroys the given object and calls the explicit destructor, if enabled
-  with CR_EnableObjectDestructor().
+/** Calls the explicit destructor of the given object with header, if
+  enabled, and detaches its header from the allocated chunk list.
 
+  @param mp The mempool to which the object belongs.
   @param ptr An object created by CR_MempoolAlloc().
+
+  @return The unpoisoned header of the object, or NULL if the object was
+  already destroyed.
 */
-void CR_DestroyObject(void *ptr)
+static Header *detachObject(CR_Mempool *mp, void *ptr)
 {
   Header *header = (Header *)ptr - 1;
   ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
-  CR_Mempool *mp = header->mp;
 
   if(header->destructor_state == DS_already_called)
   {
-    CR_ExitFailure("passed the same object to CR_DestroyObject() twice");
+    ASAN_POISON_MEMORY_REGION(header, sizeof(Header));
+    return NULL;
   }
   const bool destructor_enabled = (header->destructor_state == DS_enabled);
   header->destructor_state = DS_already_called;
@@ -267,13 +828,41 @@ void CR_DestroyObject(void *ptr)
     mp->allocated_chunks = mp->allocated_chunks->next;
   }
 
-#ifdef CREGION_ALWAYS_FRESH_MALLOC
-  free(header);
-#else
-  /* Prepend header to released chunk list. */
-  header->prev = NULL;
-  header->next = mp->released_chunks;
-  mp->released_chunks = header;
+  return header;
+}
+
+/** Destroys the given object without locking its mempool.
+
+  @param mp The mempool to which the object belongs.
+  @param ptr An object created by CR_MempoolAlloc().
+
+  @return False if the object was already destroyed.
+*/
+static bool destroyObject(CR_Mempool *mp, void *ptr)
+{
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  Slab *slab = getSlab(ptr);
+  if(!mp->has_headers)
+  {
+    return destroyWithoutHeader(mp, slab, ptr);
+  }
+#endif
+
+  Header *header = detachObject(mp, ptr);
+  if(header == NULL)
+  {
+    return false;
+  }
+
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  freeChunk(header);
+#else
+  setAllocated(slab, ptr, false);
+
+  /* Prepend header to released chunk list. */
+  header->prev = NULL;
+  header->next = mp->released_chunks;
+  mp->released_chunks = header;
 
   if(header->next != NULL)
   {
@@ -283,4 +872,900 @@ void CR_DestroyObject(void *ptr)
   }
   ASAN_POISON_MEMORY_REGION(mp->released_chunks, mp->chunk_size);
 #endif
+
+  return true;
+}
+
+/** Destroys the given object and calls the explicit destructor, if enabled
+  with CR_EnableObjectDestructor().
+
+  @param ptr An object created by CR_MempoolAlloc().
+*/
+void CR_DestroyObject(void *ptr)
+{
+  CR_Mempool *mp = getMempool(ptr);
+  if(mp->owner != NULL && mp->owner != CR_GetThreadId())
+  {
+    /* The object can't be poisoned after pushing it, because the owner
+       may already be reusing it. */
+    RemoteObject *object = ptr;
+    CR_AtomicPush(&mp->remote_objects, object, &object->next);
+    return;
+  }
+
+  bool destroyed;
+  if(!mp->thread_safe)
+  {
+    destroyed = destroyObject(mp, ptr);
+  }
+  else
+  {
+    CR_SpinlockAcquire(&mp->lock);
+    destroyed = destroyObject(mp, ptr);
+    CR_SpinlockRelease(&mp->lock);
+  }
+
+  if(!destroyed)
+  {
+    CR_ExitFailure("passed the same object to CR_DestroyObject() twice");
+  }
+}
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+/** Like allocWithoutHeader(), but allocates multiple objects and takes
+  them from the free object list in one pass. */
+static void allocWithoutHeaderBatch(CR_Mempool *mp, void **ptrs, size_t count)
+{
+  size_t index = 0;
+  FreeObject *object = mp->free_objects;
+  for(; index < count && object != NULL; index++)
+  {
+    ASAN_UNPOISON_MEMORY_REGION(object, mp->chunk_size);
+    setAllocated(getSlab(object), object, true);
+    ptrs[index] = object;
+    object = object->next;
+  }
+  mp->free_objects = object;
+
+  for(; index < count; index++)
+  {
+    ptrs[index] = allocWithoutHeader(mp);
+  }
+}
+
+/** Like destroyWithoutHeader(), but returns multiple objects to the free
+  object list with a single update of the list.
+
+  @return False if one of the objects was already destroyed. All objects
+  preceding it will be destroyed.
+*/
+static bool destroyWithoutHeaderBatch(CR_Mempool *mp, void **ptrs,
+                                      size_t count)
+{
+  FreeObject *first = NULL;
+  FreeObject *last = NULL;
+  bool destroyed = true;
+
+  for(size_t index = 0; index < count; index++)
+  {
+    Slab *slab = getSlab(ptrs[index]);
+    if(!isAllocated(slab, ptrs[index]))
+    {
+      destroyed = false;
+      break;
+    }
+    setAllocated(slab, ptrs[index], false);
+
+    FreeObject *object = ptrs[index];
+    object->next = first;
+    first = object;
+    if(last == NULL)
+    {
+      last = object;
+    }
+    else
+    {
+      ASAN_POISON_MEMORY_REGION(object, mp->chunk_size);
+    }
+  }
+
+  if(last != NULL)
+  {
+    last->next = mp->free_objects;
+    mp->free_objects = first;
+    ASAN_POISON_MEMORY_REGION(last, mp->chunk_size);
+  }
+
+  return destroyed;
+}
+
+/** Like destroyObject(), but destroys multiple objects with headers and
+  prepends them to the released chunk list in one step.
+
+  @return False if one of the objects was already destroyed. All objects
+  preceding it will be destroyed.
+*/
+static bool destroyWithHeaderBatch(CR_Mempool *mp, void **ptrs, size_t count)
+{
+  Header *first = NULL;
+  Header *last = NULL;
+  bool destroyed = true;
+
+  for(size_t index = 0; index < count; index++)
+  {
+    Header *header = detachObject(mp, ptrs[index]);
+    if(header == NULL)
+    {
+      destroyed = false;
+      break;
+    }
+    setAllocated(getSlab(ptrs[index]), ptrs[index], false);
+
+    /* Build the chain in batch order, to reuse the objects in the same
+       order in which they were passed. */
+    header->prev = last;
+    if(last == NULL)
+    {
+      first = header;
+    }
+    else
+    {
+      ASAN_UNPOISON_MEMORY_REGION(last, sizeof(Header));
+      last->next = header;
+      ASAN_POISON_MEMORY_REGION(last, mp->chunk_size);
+    }
+    last = header;
+    ASAN_POISON_MEMORY_REGION(header, sizeof(Header));
+  }
+
+  if(last != NULL)
+  {
+    /* Splice the chain in front of the released chunk list. */
+    ASAN_UNPOISON_MEMORY_REGION(last, sizeof(Header));
+    last->next = mp->released_chunks;
+    ASAN_POISON_MEMORY_REGION(last, mp->chunk_size);
+
+    if(mp->released_chunks != NULL)
+    {
+      ASAN_UNPOISON_MEMORY_REGION(mp->released_chunks, sizeof(Header));
+      mp->released_chunks->prev = last;
+      ASAN_POISON_MEMORY_REGION(mp->released_chunks, sizeof(Header));
+    }
+    mp->released_chunks = first;
+  }
+
+  return destroyed;
+}
+#endif
+
+/** Like allocObject(), but allocates multiple objects with headers and
+  prepends them to the allocated chunk list in one step. */
+static void allocWithHeaderBatch(CR_Mempool *mp, void **ptrs, size_t count)
+{
+  if(count == 0)
+  {
+    return;
+  }
+
+  Header *first = NULL;
+  Header *last = NULL;
+  size_t index = 0;
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  /* Take a run of released chunks, which are already linked together. */
+  first = mp->released_chunks;
+  for(Header *header = first; header != NULL && index < count; index++)
+  {
+    ASAN_UNPOISON_MEMORY_REGION(header, mp->chunk_size);
+    header->destructor_state = DS_disabled;
+    header->mp = mp;
+    setAllocated(getSlab(header + 1), header + 1, true);
+    ptrs[index] = header + 1;
+
+    last = header;
+    header = header->next;
+    ASAN_POISON_MEMORY_REGION(last, sizeof(Header));
+  }
+
+  if(last != NULL)
+  {
+    ASAN_UNPOISON_MEMORY_REGION(last, sizeof(Header));
+    mp->released_chunks = last->next;
+    ASAN_POISON_MEMORY_REGION(last, sizeof(Header));
+
+    if(mp->released_chunks != NULL)
+    {
+      ASAN_UNPOISON_MEMORY_REGION(mp->released_chunks, sizeof(Header));
+      mp->released_chunks->prev = NULL;
+      ASAN_POISON_MEMORY_REGION(mp->released_chunks, sizeof(Header));
+    }
+  }
+#endif
+
+  /* Append new chunks to the chain. */
+  for(; index < count; index++)
+  {
+    Header *header = getAvailableChunk(mp);
+    header->destructor_state = DS_disabled;
+    header->mp = mp;
+    header->prev = last;
+    if(last == NULL)
+    {
+      first = header;
+    }
+    else
+    {
+      ASAN_UNPOISON_MEMORY_REGION(last, sizeof(Header));
+      last->next = header;
+      ASAN_POISON_MEMORY_REGION(last, sizeof(Header));
+    }
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    setAllocated(getSlab(header + 1), header + 1, true);
+#endif
+    ptrs[index] = header + 1;
+
+    last = header;
+    ASAN_POISON_MEMORY_REGION(header, sizeof(Header));
+  }
+
+  /* Splice the chain in front of the allocated chunk list. */
+  ASAN_UNPOISON_MEMORY_REGION(last, sizeof(Header));
+  last->next = mp->allocated_chunks;
+  ASAN_POISON_MEMORY_REGION(last, sizeof(Header));
+
+  if(mp->allocated_chunks != NULL)
+  {
+    ASAN_UNPOISON_MEMORY_REGION(mp->allocated_chunks, sizeof(Header));
+    mp->allocated_chunks->prev = last;
+    ASAN_POISON_MEMORY_REGION(mp->allocated_chunks, sizeof(Header));
+  }
+  mp->allocated_chunks = first;
+}
+
+/** Allocates multiple objects at once. This is faster than calling
+  CR_MempoolAlloc() repeatedly, especially for thread-safe pools, which
+  will only be locked once.
+
+  @param mp The mempool to allocate from.
+  @param ptrs The array in which the objects will be stored.
+  @param count The amount of objects to allocate.
+*/
+void CR_MempoolAllocBatch(CR_Mempool *mp, void **ptrs, size_t count)
+{
+  if(mp->thread_safe)
+  {
+    CR_SpinlockAcquire(&mp->lock);
+  }
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  if(!mp->has_headers)
+  {
+    allocWithoutHeaderBatch(mp, ptrs, count);
+  }
+  else
+#endif
+  {
+    allocWithHeaderBatch(mp, ptrs, count);
+  }
+
+  if(mp->thread_safe)
+  {
+    CR_SpinlockRelease(&mp->lock);
+  }
+}
+
+/** Destroys multiple objects belonging to the same mempool.
+
+  @return False if one of the objects was already destroyed.
+*/
+static bool destroyObjectBatch(CR_Mempool *mp, void **ptrs, size_t count)
+{
+  if(mp->owner != NULL && mp->owner != CR_GetThreadId())
+  {
+    /* Push all objects as one chain. */
+    for(size_t index = 0; index + 1 < count; index++)
+    {
+      RemoteObject *object = ptrs[index];
+      object->next = ptrs[index + 1];
+    }
+    RemoteObject *last = ptrs[count - 1];
+    CR_AtomicPush(&mp->remote_objects, ptrs[0], &last->next);
+    return true;
+  }
+
+  if(mp->thread_safe)
+  {
+    CR_SpinlockAcquire(&mp->lock);
+  }
+
+  bool destroyed = true;
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  for(size_t index = 0; index < count && destroyed; index++)
+  {
+    destroyed = destroyObject(mp, ptrs[index]);
+  }
+#else
+  if(!mp->has_headers)
+  {
+    destroyed = destroyWithoutHeaderBatch(mp, ptrs, count);
+  }
+  else
+  {
+    destroyed = destroyWithHeaderBatch(mp, ptrs, count);
+  }
+#endif
+
+  if(mp->thread_safe)
+  {
+    CR_SpinlockRelease(&mp->lock);
+  }
+
+  return destroyed;
+}
+
+/** Like CR_DestroyObject(), but destroys multiple objects at once. This is
+  faster than calling CR_DestroyObject() repeatedly, especially for
+  consecutive objects from the same mempool.
+
+  @param ptrs The objects to destroy, which can belong to different
+  mempools.
+  @param count The amount of objects to destroy.
+*/
+void CR_DestroyObjects(void **ptrs, size_t count)
+{
+  size_t index = 0;
+  while(index < count)
+  {
+    CR_Mempool *mp = getMempool(ptrs[index]);
+    size_t end = index + 1;
+    while(end < count && getMempool(ptrs[end]) == mp)
+    {
+      end++;
+    }
+
+    if(!destroyObjectBatch(mp, &ptrs[index], end - index))
+    {
+      CR_ExitFailure("passed the same object to CR_DestroyObject() twice");
+    }
+    index = end;
+  }
+}
+
+/** Destroys all objects of the given mempool and makes their memory
+  reusable, without releasing the mempool itself. Objects with an enabled
+  destructor will be passed to the implicit destructor. All memory stays
+  owned by the pool and will be reused by future allocations.
+
+  @param mp The mempool to clear. If it is thread-safe, no other thread
+  may use it or its caches during this call.
+*/
+void CR_MempoolClear(CR_Mempool *mp)
+{
+  if(mp->thread_safe)
+  {
+    CR_SpinlockAcquire(&mp->lock);
+  }
+
+  callImplicitDestructors(mp);
+
+  /* Discard objects kept by caches and other threads. */
+  for(CR_MempoolCache *cache = mp->caches; cache != NULL; cache = cache->next)
+  {
+    cache->loaded->count = 0;
+    cache->previous->count = 0;
+  }
+  while(mp->full_magazines != NULL)
+  {
+    Magazine *magazine = mp->full_magazines;
+    mp->full_magazines = magazine->next;
+    magazine->count = 0;
+    magazine->next = mp->empty_magazines;
+    mp->empty_magazines = magazine;
+  }
+  (void)CR_AtomicTakeAll(&mp->remote_objects);
+
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  freeAllChunks(mp);
+#else
+  /* Recycle whole slabs instead of the objects in them. */
+  while(mp->slabs != NULL)
+  {
+    Slab *slab = mp->slabs;
+    mp->slabs = slab->next;
+
+    slab->live_objects = 0;
+    memset(slab->allocated_objects, 0, sizeof(slab->allocated_objects));
+    ASAN_POISON_MEMORY_REGION((unsigned char *)slab + mp->first_chunk_offset,
+                              mp->slab_size - mp->first_chunk_offset);
+
+    slab->next = mp->spare_slabs;
+    mp->spare_slabs = slab;
+  }
+  mp->next_chunk = NULL;
+  mp->chunks_left = 0;
+#endif
+
+  mp->allocated_chunks = NULL;
+  mp->released_chunks = NULL;
+  mp->free_objects = NULL;
+
+  if(mp->thread_safe)
+  {
+    CR_SpinlockRelease(&mp->lock);
+  }
+}
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+/** Removes all objects in empty slabs from the free object lists of the
+  given mempool. */
+static void removeObjectsInEmptySlabs(CR_Mempool *mp)
+{
+  FreeObject *object = mp->free_objects;
+  FreeObject *last_object = NULL;
+  mp->free_objects = NULL;
+  while(object != NULL)
+  {
+    ASAN_UNPOISON_MEMORY_REGION(object, sizeof(FreeObject));
+    FreeObject *next = object->next;
+    if(getSlab(object)->live_objects != 0)
+    {
+      object->next = NULL;
+      ASAN_POISON_MEMORY_REGION(object, sizeof(FreeObject));
+      if(last_object != NULL)
+      {
+        ASAN_UNPOISON_MEMORY_REGION(last_object, sizeof(FreeObject));
+        last_object->next = object;
+        ASAN_POISON_MEMORY_REGION(last_object, sizeof(FreeObject));
+      }
+      else
+      {
+        mp->free_objects = object;
+      }
+      last_object = object;
+    }
+    object = next;
+  }
+
+  Header *header = mp->released_chunks;
+  Header *last_header = NULL;
+  mp->released_chunks = NULL;
+  while(header != NULL)
+  {
+    ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
+    Header *next = header->next;
+    if(getSlab(header)->live_objects != 0)
+    {
+      header->prev = last_header;
+      header->next = NULL;
+      ASAN_POISON_MEMORY_REGION(header, sizeof(Header));
+      if(last_header != NULL)
+      {
+        ASAN_UNPOISON_MEMORY_REGION(last_header, sizeof(Header));
+        last_header->next = header;
+        ASAN_POISON_MEMORY_REGION(last_header, sizeof(Header));
+      }
+      else
+      {
+        mp->released_chunks = header;
+      }
+      last_header = header;
+    }
+    header = next;
+  }
+}
+
+/** Returns objects in the depot and objects destroyed by other threads to
+  their slabs. */
+static void returnUnusedObjects(CR_Mempool *mp)
+{
+  while(mp->full_magazines != NULL)
+  {
+    Magazine *magazine = mp->full_magazines;
+    mp->full_magazines = magazine->next;
+
+    while(magazine->count > 0)
+    {
+      magazine->count--;
+      void *object = magazine->objects[magazine->count];
+      ASAN_UNPOISON_MEMORY_REGION(object, mp->chunk_size);
+      (void)destroyWithoutHeader(mp, getSlab(object), object);
+    }
+    magazine->next = mp->empty_magazines;
+    mp->empty_magazines = magazine;
+  }
+
+  if(mp->owner != NULL)
+  {
+    takeRemoteObjects(mp);
+  }
+}
+
+/** Frees the given slab. Its objects must not be referenced anymore. */
+static void freeSlab(CR_Mempool *mp, Slab *slab)
+{
+  if(slab->prev != NULL)
+  {
+    slab->prev->next = slab->next;
+  }
+  else
+  {
+    mp->slabs = slab->next;
+
+    /* Stop carving from the current slab. */
+    mp->next_chunk = NULL;
+    mp->chunks_left = 0;
+  }
+  if(slab->next != NULL)
+  {
+    slab->next->prev = slab->prev;
+  }
+
+  ASAN_UNPOISON_MEMORY_REGION(slab, mp->slab_size);
+  CR_PageFree(slab, mp->slab_size);
+}
+#endif
+
+/** Returns the memory of all slabs without allocated objects to the
+  system. Objects kept by caches of thread-safe pools will not be
+  released. If the pool has the remote_destroy option, this function must
+  be called by the thread owning it.
+
+  @param mp The mempool to trim.
+
+  @return The amount of bytes returned to the system.
+*/
+size_t CR_MempoolTrim(CR_Mempool *mp)
+{
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  (void)mp;
+  return 0;
+#else
+  if(mp->thread_safe)
+  {
+    CR_SpinlockAcquire(&mp->lock);
+  }
+
+  returnUnusedObjects(mp);
+  removeObjectsInEmptySlabs(mp);
+
+  size_t bytes_released = 0;
+  Slab *slab = mp->slabs;
+  while(slab != NULL)
+  {
+    Slab *next = slab->next;
+    if(slab->live_objects == 0)
+    {
+      freeSlab(mp, slab);
+      bytes_released += mp->slab_size;
+    }
+    slab = next;
+  }
+
+  while(mp->spare_slabs != NULL)
+  {
+    Slab *spare = mp->spare_slabs;
+    mp->spare_slabs = spare->next;
+    ASAN_UNPOISON_MEMORY_REGION(spare, mp->slab_size);
+    CR_PageFree(spare, mp->slab_size);
+    bytes_released += mp->slab_size;
+  }
+
+  if(mp->thread_safe)
+  {
+    CR_SpinlockRelease(&mp->lock);
+  }
+
+  return bytes_released;
+#endif
+}
+
+/** Preallocates memory for the given amount of objects, so that
+  allocating them later will not need to request memory from the system.
+  Objects which are already free in the pool are not taken into account.
+  Reserved memory can be released by CR_MempoolTrim().
+
+  @param mp The mempool for which memory should be reserved.
+  @param count The amount of objects to reserve memory for.
+  @param prefault True if the reserved memory should be written to, to
+  avoid page faults on first use. This makes the system back the memory
+  immediately, even if it never gets used.
+*/
+void CR_MempoolReserve(CR_Mempool *mp, size_t count, bool prefault)
+{
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  (void)mp;
+  (void)count;
+  (void)prefault;
+#else
+  if(mp->thread_safe)
+  {
+    CR_SpinlockAcquire(&mp->lock);
+  }
+
+  size_t chunks_available = mp->chunks_left;
+  for(Slab *slab = mp->spare_slabs; slab != NULL; slab = slab->next)
+  {
+    chunks_available = CR_SafeAdd(chunks_available, mp->chunks_per_slab);
+  }
+
+  while(chunks_available < count)
+  {
+    Slab *slab = newSlab(mp);
+
+    if(prefault)
+    {
+      unsigned char *data = (unsigned char *)slab;
+      memset(&data[mp->first_chunk_offset], 0,
+             mp->slab_size - mp->first_chunk_offset);
+      ASAN_POISON_MEMORY_REGION(&data[mp->first_chunk_offset],
+                                mp->slab_size - mp->first_chunk_offset);
+    }
+
+    slab->next = mp->spare_slabs;
+    mp->spare_slabs = slab;
+    chunks_available += mp->chunks_per_slab;
+  }
+
+  if(mp->thread_safe)
+  {
+    CR_SpinlockRelease(&mp->lock);
+  }
+#endif
+}
+
+/** Passes all allocated objects of the given mempool to the specified
+  function. Objects are visited slab by slab in the order of their
+  addresses, which is much faster than following pointers between them.
+
+  @param mp The mempool to iterate over. If it is thread-safe, its caches
+  should be flushed and no other thread may use it during this call. If
+  the pool has the remote_destroy option, this function must be called by
+  the thread owning it.
+  @param function The function to call for each object. It may destroy
+  the object passed to it, but no other objects of the same pool.
+  @param data Arbitrary data passed to the function.
+*/
+void CR_MempoolForEach(CR_Mempool *mp, CR_MempoolVisitor *function,
+                       void *data)
+{
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  /* Objects are scattered across the heap and only tracked by list. */
+  Header *header = mp->allocated_chunks;
+  while(header != NULL)
+  {
+    ASAN_UNPOISON_MEMORY_REGION(header, sizeof(Header));
+    Header *next = header->next;
+    ASAN_POISON_MEMORY_REGION(header, sizeof(Header));
+
+    function(header + 1, data);
+    header = next;
+  }
+#else
+  if(mp->thread_safe)
+  {
+    CR_SpinlockAcquire(&mp->lock);
+    returnUnusedObjects(mp);
+    CR_SpinlockRelease(&mp->lock);
+  }
+  else
+  {
+    returnUnusedObjects(mp);
+  }
+
+  for(Slab *slab = mp->slabs; slab != NULL; slab = slab->next)
+  {
+    unsigned char *slab_data = (unsigned char *)slab;
+    for(size_t index = 0; index < sizeof(slab->allocated_objects); index++)
+    {
+      /* Copy the bits, to allow destroying the current object. */
+      unsigned int bits = slab->allocated_objects[index];
+      for(size_t bit = 0; bits != 0; bit++, bits >>= 1)
+      {
+        if((bits & 1) != 0)
+        {
+          function(&slab_data[(index * CHAR_BIT + bit) * min_alignment],
+                   data);
+        }
+      }
+    }
+  }
+#endif
+}
+
+/** Allocates an empty magazine. */
+static Magazine *newMagazine(void)
+{
+  Magazine *magazine = malloc(sizeof *magazine);
+  if(magazine == NULL)
+  {
+    CR_ExitFailure("failed to allocate %zu bytes", sizeof *magazine);
+  }
+
+  magazine->next = NULL;
+  magazine->count = 0;
+  return magazine;
+}
+
+/** Creates a cache, which allows a single thread to allocate and destroy
+  objects of a thread-safe mempool without locking it most of the time.
+  Each thread sharing the pool should use its own cache.
+
+  @param mp A mempool created with the thread_safe option. This function
+  can be called from any thread.
+
+  @return A cache bound to the lifetime of the mempool.
+*/
+CR_MempoolCache *CR_MempoolCacheNew(CR_Mempool *mp)
+{
+  if(!mp->thread_safe)
+  {
+    CR_ExitFailure("unable to create cache for memory pool which is not thread-safe");
+  }
+
+  CR_MempoolCache *cache = malloc(sizeof *cache);
+  if(cache == NULL)
+  {
+    CR_ExitFailure("failed to allocate %zu bytes", sizeof *cache);
+  }
+
+  cache->mp = mp;
+  cache->loaded = newMagazine();
+  cache->previous = newMagazine();
+
+  CR_SpinlockAcquire(&mp->lock);
+  cache->next = mp->caches;
+  mp->caches = cache;
+  CR_SpinlockRelease(&mp->lock);
+
+  return cache;
+}
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+/** Swaps the loaded and the previous magazine of the given cache. */
+static void swapMagazines(CR_MempoolCache *cache)
+{
+  Magazine *loaded = cache->loaded;
+  cache->loaded = cache->previous;
+  cache->previous = loaded;
+}
+
+/** Replaces the empty previous magazine of the given cache with a full
+  one, either from the depot or filled with new objects. */
+static void refillCache(CR_MempoolCache *cache)
+{
+  CR_Mempool *mp = cache->mp;
+  CR_SpinlockAcquire(&mp->lock);
+
+  if(mp->full_magazines != NULL)
+  {
+    Magazine *full = mp->full_magazines;
+    mp->full_magazines = full->next;
+
+    cache->previous->next = mp->empty_magazines;
+    mp->empty_magazines = cache->previous;
+    cache->previous = full;
+  }
+  else
+  {
+    Magazine *magazine = cache->previous;
+    while(magazine->count < magazine_size)
+    {
+      void *object = allocWithoutHeader(mp);
+      ASAN_POISON_MEMORY_REGION(object, mp->chunk_size);
+      magazine->objects[magazine->count] = object;
+      magazine->count++;
+    }
+  }
+
+  CR_SpinlockRelease(&mp->lock);
+}
+
+/** Moves the full previous magazine of the given cache into the depot
+  and replaces it with an empty one. */
+static void exchangeFullMagazine(CR_MempoolCache *cache)
+{
+  CR_Mempool *mp = cache->mp;
+  CR_SpinlockAcquire(&mp->lock);
+
+  cache->previous->next = mp->full_magazines;
+  mp->full_magazines = cache->previous;
+
+  Magazine *empty = mp->empty_magazines;
+  if(empty != NULL)
+  {
+    mp->empty_magazines = empty->next;
+  }
+
+  CR_SpinlockRelease(&mp->lock);
+
+  cache->previous = empty != NULL ? empty : newMagazine();
+}
+#endif
+
+/** Like CR_MempoolAlloc(), but allocates from the given cache. Objects
+  allocated this way can be destroyed by any cache of the same pool or by
+  CR_DestroyObject().
+
+  @param cache A cache which is only used by the calling thread.
+
+  @return Uninitialized, reused memory.
+*/
+void *CR_MempoolCacheAlloc(CR_MempoolCache *cache)
+{
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  return CR_MempoolAlloc(cache->mp);
+#else
+  if(cache->loaded->count == 0)
+  {
+    if(cache->previous->count == 0)
+    {
+      refillCache(cache);
+    }
+    swapMagazines(cache);
+  }
+
+  Magazine *loaded = cache->loaded;
+  loaded->count--;
+
+  void *object = loaded->objects[loaded->count];
+  ASAN_UNPOISON_MEMORY_REGION(object, cache->mp->chunk_size);
+  return object;
+#endif
+}
+
+/** Like CR_DestroyObject(), but keeps the object in the given cache for
+  reuse. Objects destroyed this way are not checked for being destroyed
+  twice.
+
+  @param cache A cache which is only used by the calling thread.
+  @param ptr An object allocated from the same pool as the cache.
+*/
+void CR_MempoolCacheDestroyObject(CR_MempoolCache *cache, void *ptr)
+{
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  (void)cache;
+  CR_DestroyObject(ptr);
+#else
+  if(cache->loaded->count == magazine_size)
+  {
+    if(cache->previous->count == magazine_size)
+    {
+      exchangeFullMagazine(cache);
+    }
+    swapMagazines(cache);
+  }
+
+  ASAN_POISON_MEMORY_REGION(ptr, cache->mp->chunk_size);
+  Magazine *loaded = cache->loaded;
+  loaded->objects[loaded->count] = ptr;
+  loaded->count++;
+#endif
+}
+
+/** Returns all objects kept by the given cache to its pool. This should
+  be called before the thread using the cache terminates, to allow other
+  threads to reuse them.
+
+  @param cache The cache to flush.
+*/
+void CR_MempoolCacheFlush(CR_MempoolCache *cache)
+{
+  CR_Mempool *mp = cache->mp;
+  CR_SpinlockAcquire(&mp->lock);
+
+  Magazine *magazines[] = { cache->loaded, cache->previous };
+  for(size_t index = 0; index < 2; index++)
+  {
+    Magazine *magazine = magazines[index];
+    while(magazine->count > 0)
+    {
+      magazine->count--;
+      void *object = magazine->objects[magazine->count];
+      ASAN_UNPOISON_MEMORY_REGION(object, mp->chunk_size);
+      (void)destroyObject(mp, object);
+    }
+  }
+
+  CR_SpinlockRelease(&mp->lock);
 }
@@ -5,21 +5,68 @@
 #ifndef CREGION_SRC_MEMPOOL_H
 #define CREGION_SRC_MEMPOOL_H
 
+#include <stdbool.h>
+
 #include "region.h"
 
 /* A memory pool. */
 typedef struct CR_Mempool CR_Mempool;
 
+/** A cache which allows one thread to use a thread-safe memory pool with
+  little locking. */
+typedef struct CR_MempoolCache CR_MempoolCache;
+
 /** A destructor function which is allowed to fail by calling exit(). The
   return value of this function will be ignored. It has the type int to be
   incompatible with CR_ReleaseCallback. */
 typedef int CR_FailableDestructor(void *data);
 
+/** A function which gets called for each object visited by
+  CR_MempoolForEach(). */
+typedef void CR_MempoolVisitor(void *object, void *data);
+
+/** Options for creating mempools via CR_MempoolNewWithOptions(). Members
+  which are zero will be replaced by their default values. */
+typedef struct
+{
+  /** The boundary to which objects will be aligned. Must be a power of two
+    not larger than 4096. Defaults to 8, which is also the minimum. */
+  size_t alignment;
+
+  /** Allows sharing the pool between threads. Such pools can not have
+    destructors. Each thread should allocate and destroy objects through
+    its own CR_MempoolCache. The region owning the pool must not be
+    released while other threads are still using it. Defaults to false. */
+  bool thread_safe;
+
+  /** Allows threads other than the one creating the pool to pass objects
+    to CR_DestroyObject() without locking. Only the creating thread may
+    allocate objects, which it does without locking. Such pools can not
+    have destructors and can not be thread-safe. Defaults to false. */
+  bool remote_destroy;
+}CR_MempoolOptions;
+
 extern CR_Mempool *CR_MempoolNew(CR_Region *r, size_t object_size,
                                  CR_FailableDestructor *explicit_destructor,
                                  CR_ReleaseCallback *implicit_destructor);
+extern CR_Mempool *
+CR_MempoolNewWithOptions(CR_Region *r, size_t object_size,
+                         CR_FailableDestructor *explicit_destructor,
+                         CR_ReleaseCallback *implicit_destructor,
+                         const CR_MempoolOptions *options);
 extern void *CR_MempoolAlloc(CR_Mempool *mp);
 extern void CR_EnableObjectDestructor(void *ptr);
+extern void CR_MempoolAllocBatch(CR_Mempool *mp, void **ptrs, size_t count);
 extern void CR_DestroyObject(void *ptr);
+extern void CR_DestroyObjects(void **ptrs, size_t count);
+extern void CR_MempoolClear(CR_Mempool *mp);
+extern size_t CR_MempoolTrim(CR_Mempool *mp);
+extern void CR_MempoolReserve(CR_Mempool *mp, size_t count, bool prefault);
+extern void CR_MempoolForEach(CR_Mempool *mp, CR_MempoolVisitor *function,
+                              void *data);
+extern CR_MempoolCache *CR_MempoolCacheNew(CR_Mempool *mp);
+extern void *CR_MempoolCacheAlloc(CR_MempoolCache *cache);
+extern void CR_MempoolCacheDestroyObject(CR_MempoolCache *cache, void *ptr);
+extern void CR_MempoolCacheFlush(CR_MempoolCache *cache);
 
 #endif
@@ -0,0 +1,197 @@
+/** @file
+  Implements functions for requesting memory pages from the operating
+  system. Pages are mapped via mmap() where available, so freeing them
+  returns the memory to the system immediately. Other systems fall back to
+  malloc().
+*/
+
+#if !defined(CREGION_ALWAYS_FRESH_MALLOC) && \
+  (defined(__unix__) || defined(__APPLE__))
+#define _DEFAULT_SOURCE
+#ifdef __APPLE__
+#define _DARWIN_C_SOURCE
+#endif
+#define CREGION_HAVE_MMAP
+#ifdef __linux__
+#define _GNU_SOURCE
+#define CREGION_HAVE_MREMAP
+#endif
+#endif
+
+#include "page-alloc.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CREGION_HAVE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "error-handling.h"
+#include "safe-math.h"
+
+#ifdef CREGION_HAVE_MMAP
+/** Returns the page size of the system. */
+static size_t getPageSize(void)
+{
+  static size_t page_size = 0;
+  if(page_size == 0)
+  {
+    const long result = sysconf(_SC_PAGESIZE);
+    page_size = result > 0 ? (size_t)result : 4096;
+  }
+
+  return page_size;
+}
+
+/** Wrapper around mmap() which maps the given amount of readable and
+  writable bytes. Terminates the program on failure. */
+static unsigned char *mapPages(size_t size)
+{
+  void *pages = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(pages == MAP_FAILED)
+  {
+    CR_ExitFailure("failed to allocate %zu bytes", size);
+  }
+
+  return pages;
+}
+
+/** Wrapper around munmap() which terminates the program on failure. */
+static void unmapPages(void *pages, size_t size)
+{
+  if(munmap(pages, size) != 0)
+  {
+    CR_ExitFailure("failed to free %zu bytes", size);
+  }
+}
+#endif
+
+/** Allocates the given amount of bytes directly from the operating
+  system.
+
+  @param size The amount of bytes to allocate. Will be rounded up to the
+  next page boundary by the system.
+
+  @return Uninitialized memory, which is aligned to at least the
+  alignment of malloc(). It must be freed via CR_PageFree(). Will never be
+  NULL.
+*/
+void *CR_PageAlloc(size_t size)
+{
+  return CR_PageAllocAligned(size, sizeof(void *));
+}
+
+/** Like CR_PageAlloc(), but aligns the returned memory to the given
+  boundary.
+
+  @param size The amount of bytes to allocate.
+  @param boundary A power of two.
+
+  @return Memory aligned to the given boundary. Will never be NULL.
+*/
+void *CR_PageAllocAligned(size_t size, size_t boundary)
+{
+  if(size == 0)
+  {
+    CR_ExitFailure("unable to allocate 0 bytes");
+  }
+  else if(boundary == 0 || (boundary & (boundary - 1)) != 0)
+  {
+    CR_ExitFailure("unable to align memory to %zu bytes", boundary);
+  }
+
+#ifdef CREGION_HAVE_MMAP
+  const size_t page_size = getPageSize();
+  if(boundary <= page_size)
+  {
+    return mapPages(size);
+  }
+
+  /* Map enough pages to contain an aligned block and unmap the pages
+     around it. */
+  const size_t mapped_size =
+    CR_SafeAdd(CR_SafeAdd(size, page_size - 1) & ~(page_size - 1),
+               boundary);
+  unsigned char *pages = mapPages(mapped_size);
+
+  const size_t head_size =
+    (boundary - ((uintptr_t)pages & (boundary - 1))) & (boundary - 1);
+  const size_t tail_size = boundary - head_size;
+  if(head_size > 0)
+  {
+    unmapPages(pages, head_size);
+  }
+  unmapPages(&pages[mapped_size - tail_size], tail_size);
+
+  return &pages[head_size];
+#else
+  /* Store the pointer returned by malloc() in front of the aligned
+     memory. */
+  const size_t allocated_size =
+    CR_SafeAdd(size, CR_SafeAdd(boundary, sizeof(void *)));
+  unsigned char *data = malloc(allocated_size);
+  if(data == NULL)
+  {
+    CR_ExitFailure("failed to allocate %zu bytes", allocated_size);
+  }
+
+  uintptr_t pages = (uintptr_t)&data[sizeof(void *)];
+  pages = (pages + boundary - 1) & ~(uintptr_t)(boundary - 1);
+  ((void **)pages)[-1] = data;
+
+  return (void *)pages;
+#endif
+}
+
+/** Returns the given pages to the operating system.
+
+  @param pages Memory returned by CR_PageAlloc() or CR_PageAllocAligned().
+  @param size The size which was passed to the allocating function.
+*/
+void CR_PageFree(void *pages, size_t size)
+{
+#ifdef CREGION_HAVE_MMAP
+  unmapPages(pages, size);
+#else
+  (void)size;
+  free(((void **)pages)[-1]);
+#endif
+}
+
+/** Resizes memory returned by CR_PageAlloc(). On Linux the pages get
+  remapped without copying their content.
+
+  @param pages Memory returned by CR_PageAlloc() or CR_PageRealloc().
+  @param old_size The current size of the memory.
+  @param new_size The new size of the memory.
+
+  @return The possibly moved memory, which must be freed via
+  CR_PageFree(). Will never be NULL.
+*/
+void *CR_PageRealloc(void *pages, size_t old_size, size_t new_size)
+{
+  if(new_size == 0)
+  {
+    CR_ExitFailure("unable to allocate 0 bytes");
+  }
+
+#ifdef CREGION_HAVE_MREMAP
+  void *remapped_pages = mremap(pages, old_size, new_size, MREMAP_MAYMOVE);
+  if(remapped_pages == MAP_FAILED)
+  {
+    CR_ExitFailure("failed to reallocate %zu bytes", new_size);
+  }
+
+  return remapped_pages;
+#else
+  void *new_pages = CR_PageAlloc(new_size);
+  memcpy(new_pages, pages, old_size < new_size ? old_size : new_size);
+  CR_PageFree(pages, old_size);
+
+  return new_pages;
+#endif
+}
@@ -0,0 +1,15 @@
+/** @file
+  Declares functions for requesting memory pages from the operating system.
+*/
+
+#ifndef CREGION_SRC_PAGE_ALLOC_H
+#define CREGION_SRC_PAGE_ALLOC_H
+
+#include <stddef.h>
+
+extern void *CR_PageAlloc(size_t size);
+extern void *CR_PageAllocAligned(size_t size, size_t boundary);
+extern void *CR_PageRealloc(void *pages, size_t old_size, size_t new_size);
+extern void CR_PageFree(void *pages, size_t size);
+
+#endif
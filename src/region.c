@@ -5,26 +5,52 @@
 #include "region.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "address-sanitizer.h"
+#include "chunk-cache.h"
 #include "error-handling.h"
+#include "page-alloc.h"
 #include "safe-math.h"
 #include "static-assert.h"
 
 #define alignment sizeof(uint64_t)
+#define max_alignment 4096
 #define first_chunk_size 1024
+#define default_aligned_percent 50
+#define default_growth_factor 2
+#define callback_block_size 1024
+#define default_large_allocation_size (256 * 1024)
 
-/** A list of callbacks. */
-typedef struct CallbackList CallbackList;
-struct CallbackList
+/** A callback together with its data. */
+typedef struct
 {
   CR_ReleaseCallback *callback;
   void *data;
+}Callback;
+
+/** A block of callbacks. Blocks are allocated separately from the chunks
+  of a region, to keep callbacks dense and out of the way of user data. */
+typedef struct CallbackBlock CallbackBlock;
+struct CallbackBlock
+{
+  /** The previously filled block. */
+  CallbackBlock *prev;
+
+  /** The amount of used elements in the callbacks array. */
+  size_t count;
 
-  CallbackList *next;
+  /** Callbacks in order of registration. Its capacity depends on
+    callback_block_size. */
+  Callback callbacks[];
 };
 
+/** The amount of callbacks which fit into one callback block. */
+#define callbacks_per_block \
+  ((callback_block_size - sizeof(CallbackBlock)) / sizeof(Callback))
+
 /** A list of allocated memory chunks. Each element is located at the
   beginning of the chunk. By freeing the element, the entire chunk will be
   freed. */
@@ -32,40 +58,117 @@ typedef struct ChunkList ChunkList;
 struct ChunkList
 {
   ChunkList *next;
+  size_t size; /**< The size of the entire chunk. */
 };
 
-typedef struct
+typedef CR_RegionChunk Chunk;
+
+/** A large allocation, which has its own pages and can be freed
+  individually. It is stored directly in front of the allocated memory. */
+typedef struct LargeAllocation LargeAllocation;
+struct LargeAllocation
 {
-  unsigned char *chunk; /**< Allocated bytes. */
-  size_t bytes_used; /**< The amount of used bytes in the chunk. */
-  size_t capacity; /**< The total capacity of the chunk. */
-  size_t next_chunk_size; /**< The size of the next chunk. */
-}Chunk;
+  /** The previous and next large allocations of the same region. */
+  LargeAllocation *prev, *next;
+
+  /** The region owning this allocation, for detecting invalid pointers
+    passed to CR_RegionFreeLarge(). */
+  CR_Region *r;
+
+  void *pages; /**< The pages containing this allocation. */
+  size_t size; /**< The size of the pages. */
+  size_t bytes_requested; /**< The size passed to the region. */
+
+  /** The number of this allocation in the order of creation. Allows
+    savepoints to find all large allocations created after them. */
+  size_t serial;
+};
 
 /** A region for allocation. */
 struct CR_Region
 {
-  Chunk aligned; /**< Chunk for aligned memory. */
-  Chunk unaligned; /**< Chunk for unaligned memory. */
+  /** The members accessed by the inline functions in region.h. Must be
+    the first member. */
+  CR_RegionHead head;
+
+  /** The most recently created large allocation. */
+  LargeAllocation *large_allocations;
+
+  /** The most recently tracked block. */
+  CR_RegionBlock *tracked_blocks;
+
+  /** The serial of the next large allocation or tracked block. */
+  size_t next_large_serial;
+
+  /** The value of next_large_serial when the most recent savepoint was
+    created. */
+  size_t last_mark_serial;
+
+  /** The amount of unused bytes left in chunks which the region stopped
+    allocating from. */
+  size_t bytes_wasted;
+
+  /** The amount of memory currently owned by the region and the largest
+    amount it ever owned. */
+  size_t bytes_owned, bytes_owned_peak;
 
   /** A list of allocated chunks for freeing on release. */
   ChunkList *chunk_list;
 
-  /** A list of callbacks to call on release. */
-  CallbackList *callback_list;
+  /** The last block of callbacks to call on release. */
+  CallbackBlock *callbacks;
 
-  /** A callback which was not yet inserted into the regions callback_list.
-    Allocating an element into the callback_list could fail and terminate
-    the program. Thus we store the callback here to ensure it can be
+  /** A callback which was not yet inserted into the regions callbacks.
+    Allocating a new callback block could fail and terminate the
+    program. Thus we store the callback here to ensure it can be
     accessed in that case. See the implementation of CR_RegionAttach() for
     more details. */
   CR_ReleaseCallback *pending_callback;
   void *pending_callback_data;
 
+  /** The maximum amount of bytes which CR_RegionReset() will keep. */
+  size_t retain_limit;
+
+  /** The factor by which the size of subsequent chunks grows. */
+  size_t growth_factor;
+
+  /** The size which subsequent chunks will not exceed. */
+  size_t max_chunk_size;
+
+  /** The size of the chunks following the first chunk. */
+  size_t second_chunk_size;
+
+  /** The size of the first chunks part used for aligned memory. The rest
+    is used for unaligned memory. */
+  size_t first_chunk_split;
+
   /** The previous and next regions. */
   CR_Region *prev, *next;
 };
 
+/** A savepoint which captures the allocation state of a region. */
+struct CR_RegionSavepoint
+{
+  Chunk aligned; /**< The state of the regions aligned chunk. */
+  Chunk unaligned; /**< The state of the regions unaligned chunk. */
+
+  /** The last allocated chunk at the time the savepoint was created. */
+  ChunkList *chunk_list;
+
+  /** The last callback block at the time the savepoint was created. */
+  CallbackBlock *callbacks;
+
+  /** The amount of callbacks in the last block at that time. */
+  size_t callback_count;
+
+  /** The serial of the next large allocation or tracked block at that
+    time. */
+  size_t next_large_serial;
+
+  /** The amount of wasted bytes at that time. */
+  size_t bytes_wasted;
+};
+
 /** A list of all allocated regions. */
 static CR_Region *region_list = NULL;
 
@@ -76,6 +179,8 @@ static void releaseAllRegions(void)
   {
     CR_RegionRelease(region_list);
   }
+
+  CR_ChunkCacheTrim();
 }
 
 /** Setups various stuff like atexit() handler the first time this function
@@ -96,49 +201,159 @@ static void ensureRegionsAreInitialized(void)
   initialized = true;
 }
 
-/** Wrapper around malloc which handles returned NULL pointers. */
-static void *checkedMalloc(size_t size)
+/** Adds the given amount of bytes to the memory owned by the specified
+  region and updates its high-water mark. */
+static void addOwnedBytes(CR_Region *r, size_t size)
 {
-  void *data = malloc(size);
-  if(data == NULL)
+  r->bytes_owned += size;
+  if(r->bytes_owned > r->bytes_owned_peak)
   {
-    CR_ExitFailure("failed to allocate %zu bytes", size);
+    r->bytes_owned_peak = r->bytes_owned;
   }
+}
 
-  return data;
+/** Returns the given chunk of a region to the chunk cache. */
+static void freeChunk(CR_Region *r, ChunkList *element)
+{
+  r->bytes_owned -= element->size;
+  CR_ChunkCacheFree(element, element->size);
+}
+
+/** Allocates a new chunk and prepends it to the chunk list of the given
+  region.
+
+  @param r The region which should own the chunk.
+  @param size The size of the entire chunk.
+
+  @return The new chunk, which starts with its chunk list element.
+*/
+static ChunkList *allocChunk(CR_Region *r, size_t size)
+{
+  ChunkList *element = CR_ChunkCacheAlloc(size);
+  element->size = size;
+  addOwnedBytes(r, size);
+
+  element->next = r->chunk_list;
+  r->chunk_list = element;
+
+  return element;
 }
 
 /** Creates a new CR_Region that gets freed automatically on exit, or
   manually via CR_RegionRelease(). */
 CR_Region *CR_RegionNew(void)
+{
+  CR_StaticAssert(first_chunk_size/2 % alignment == 0);
+  CR_StaticAssert(sizeof(ChunkList) + sizeof(CR_Region) < first_chunk_size/2);
+
+  static const CR_RegionOptions default_options;
+  return CR_RegionNewWithOptions(&default_options);
+}
+
+/** Returns the given value, or the specified default if it is zero. */
+static size_t valueOrDefault(size_t value, size_t default_value)
+{
+  return value == 0 ? default_value : value;
+}
+
+/** Like CR_RegionNew(), but allows configuring the regions chunks.
+
+  @param options The options to use. Members which are zero will be
+  replaced by their defaults. See CR_RegionOptions for details.
+
+  @return A new region.
+*/
+CR_Region *CR_RegionNewWithOptions(const CR_RegionOptions *options)
 {
   ensureRegionsAreInitialized();
   CR_StaticAssert(alignment == 8);
   CR_StaticAssert(sizeof(CR_Region) % alignment == 0);
   CR_StaticAssert(sizeof(ChunkList) % alignment == 0);
-  CR_StaticAssert(first_chunk_size/2 % alignment == 0);
-  CR_StaticAssert(sizeof(ChunkList) + sizeof(CR_Region) < first_chunk_size/2);
+  CR_StaticAssert(offsetof(CR_Region, head) == 0);
+  CR_StaticAssert(sizeof(LargeAllocation) % alignment == 0);
+  CR_StaticAssert(callbacks_per_block > 0);
+
+  const size_t initial_capacity =
+    valueOrDefault(options->initial_capacity, first_chunk_size);
+  const size_t aligned_percent =
+    valueOrDefault(options->aligned_percent, default_aligned_percent);
+  const size_t growth_factor =
+    valueOrDefault(options->growth_factor, default_growth_factor);
+  const size_t max_chunk_size =
+    valueOrDefault(options->max_chunk_size, SIZE_MAX);
+  const size_t large_allocation_size =
+    valueOrDefault(options->large_allocation_size,
+                   default_large_allocation_size);
+
+  if(aligned_percent > 100)
+  {
+    CR_ExitFailure("aligned part of region exceeds 100 percent: %zu",
+                   aligned_percent);
+  }
+
+  /* The aligned part gets rounded down to a multiple of the alignment. */
+  const size_t first_chunk_split =
+    (CR_SafeMultiply(initial_capacity, aligned_percent) / 100) &
+    ~(alignment - 1);
+  if(first_chunk_split < sizeof(ChunkList) + sizeof(CR_Region))
+  {
+    CR_ExitFailure("initial region capacity too small: %zu bytes",
+                   initial_capacity);
+  }
+  else if(max_chunk_size < initial_capacity)
+  {
+    CR_ExitFailure("maximum chunk size smaller than initial capacity: %zu bytes",
+                   max_chunk_size);
+  }
+
+  /* Huge growth factors are fine if the chunk size is limited. */
+  size_t next_chunk_size = max_chunk_size;
+  if(options->max_chunk_size == 0)
+  {
+    next_chunk_size = CR_SafeMultiply(initial_capacity, growth_factor);
+  }
+  else if(initial_capacity <= max_chunk_size / growth_factor)
+  {
+    next_chunk_size = initial_capacity * growth_factor;
+  }
 
   /* The region and its chunk-list are part of the first chunk. */
-  ChunkList *element = checkedMalloc(first_chunk_size);
+  ChunkList *element = CR_ChunkCacheAlloc(initial_capacity);
+  element->size = initial_capacity;
   CR_Region *r = (CR_Region *)(element + 1);
 
-  r->aligned.chunk = (unsigned char *)element;
-  r->aligned.bytes_used = (sizeof *element) + (sizeof *r);
-  r->aligned.capacity = first_chunk_size/2;
-  r->aligned.next_chunk_size = first_chunk_size * 2;
+  r->head.aligned.chunk = (unsigned char *)element;
+  r->head.aligned.bytes_used = (sizeof *element) + (sizeof *r);
+  r->head.aligned.capacity = first_chunk_split;
+  r->head.aligned.next_chunk_size = next_chunk_size;
+  r->head.aligned.bytes_requested = 0;
 
-  r->unaligned.chunk = &r->aligned.chunk[first_chunk_size/2];
-  r->unaligned.bytes_used = 0;
-  r->unaligned.capacity = first_chunk_size/2;
-  r->unaligned.next_chunk_size = first_chunk_size * 2;
+  r->head.unaligned.chunk = &r->head.aligned.chunk[first_chunk_split];
+  r->head.unaligned.bytes_used = 0;
+  r->head.unaligned.capacity = initial_capacity - first_chunk_split;
+  r->head.unaligned.next_chunk_size = next_chunk_size;
+  r->head.unaligned.bytes_requested = 0;
 
   r->chunk_list = element;
   r->chunk_list->next = NULL;
 
-  r->callback_list = NULL;
+  r->head.large_allocation_size = large_allocation_size;
+  r->large_allocations = NULL;
+  r->tracked_blocks = NULL;
+  r->next_large_serial = 0;
+  r->last_mark_serial = 0;
+  r->bytes_wasted = 0;
+  r->bytes_owned = initial_capacity;
+  r->bytes_owned_peak = initial_capacity;
+
+  r->callbacks = NULL;
   r->pending_callback = NULL;
   r->pending_callback_data = NULL;
+  r->retain_limit = SIZE_MAX;
+  r->growth_factor = growth_factor;
+  r->max_chunk_size = max_chunk_size;
+  r->second_chunk_size = next_chunk_size;
+  r->first_chunk_split = first_chunk_split;
 
   /* Prepend region to region list. */
   r->prev = NULL;
@@ -182,27 +397,156 @@ static void *allocFromChunk(CR_Region *r, Chunk *chunk, size_t size)
   }
   else if(size < chunk->next_chunk_size - sizeof(ChunkList))
   {
-    ChunkList *element = checkedMalloc(chunk->next_chunk_size);
+    ChunkList *element = allocChunk(r, chunk->next_chunk_size);
+    r->bytes_wasted += chunk->capacity - chunk->bytes_used;
 
     chunk->chunk = (unsigned char *)element;
     chunk->bytes_used = sizeof *element;
     chunk->capacity = chunk->next_chunk_size;
 
-    element->next = r->chunk_list;
-    r->chunk_list = element;
-
-    chunk->next_chunk_size = CR_SafeMultiply(chunk->next_chunk_size, 2);
+    if(chunk->next_chunk_size > r->max_chunk_size / r->growth_factor)
+    {
+      chunk->next_chunk_size = r->max_chunk_size;
+    }
+    else
+    {
+      chunk->next_chunk_size *= r->growth_factor;
+    }
 
     return popBytesFromChunk(chunk, size);
   }
   else
   {
-    ChunkList *element = checkedMalloc(CR_SafeAdd(sizeof(ChunkList), size));
+    ChunkList *element = allocChunk(r, CR_SafeAdd(sizeof(ChunkList), size));
+    return element + 1;
+  }
+}
 
-    element->next = r->chunk_list;
-    r->chunk_list = element;
+/** Returns the amount of bytes required to round the given value up to a
+  multiple of the specified boundary.
 
-    return element + 1;
+  @param value The value or address to round up.
+  @param boundary A power of two.
+
+  @return The difference to the next multiple of boundary.
+*/
+static size_t getPadding(uintptr_t value, size_t boundary)
+{
+  return (boundary - (value & (boundary - 1))) & (boundary - 1);
+}
+
+/** Allocates memory with its own pages and prepends it to the large
+  allocations of the given region.
+
+  @param r The region which should own the allocation.
+  @param size The amount of bytes to allocate.
+  @param boundary The boundary to which the returned memory should be
+  aligned. Must be a power of two not smaller than the default alignment.
+
+  @return The allocated memory, which can be passed to
+  CR_RegionFreeLarge(). Will never be NULL.
+*/
+static void *allocLarge(CR_Region *r, size_t size, size_t boundary)
+{
+  /* The pages are aligned to at least the default alignment. */
+  const size_t pages_size =
+    CR_SafeAdd(CR_SafeAdd(sizeof(LargeAllocation), boundary - alignment),
+               size);
+  unsigned char *pages = CR_PageAlloc(pages_size);
+  addOwnedBytes(r, pages_size);
+
+  unsigned char *data = &pages[sizeof(LargeAllocation)];
+  data = &data[getPadding((uintptr_t)data, boundary)];
+
+  LargeAllocation *allocation = (LargeAllocation *)data - 1;
+  allocation->r = r;
+  allocation->pages = pages;
+  allocation->size = pages_size;
+  allocation->bytes_requested = size;
+  allocation->serial = r->next_large_serial;
+  r->next_large_serial++;
+
+  allocation->prev = NULL;
+  allocation->next = r->large_allocations;
+  if(r->large_allocations != NULL)
+  {
+    r->large_allocations->prev = allocation;
+  }
+  r->large_allocations = allocation;
+
+  return data;
+}
+
+/** Unlinks the given large allocation from its region and frees it. */
+static void freeLarge(CR_Region *r, LargeAllocation *allocation)
+{
+  if(allocation->prev == NULL)
+  {
+    r->large_allocations = allocation->next;
+  }
+  else
+  {
+    allocation->prev->next = allocation->next;
+  }
+
+  if(allocation->next != NULL)
+  {
+    allocation->next->prev = allocation->prev;
+  }
+
+  r->bytes_owned -= allocation->size;
+  allocation->r = NULL;
+  CR_PageFree(allocation->pages, allocation->size);
+}
+
+/** Frees all large allocations of the given region which have a serial
+  not smaller than the specified one. */
+static void freeLargeAllocationsSince(CR_Region *r, size_t serial)
+{
+  while(r->large_allocations != NULL &&
+        r->large_allocations->serial >= serial)
+  {
+    freeLarge(r, r->large_allocations);
+  }
+}
+
+/** Unlinks the given block from its region and frees it. */
+static void freeTrackedBlock(CR_Region *r, CR_RegionBlock *block)
+{
+  if(block->prev == NULL)
+  {
+    r->tracked_blocks = block->next;
+  }
+  else
+  {
+    block->prev->next = block->next;
+  }
+
+  if(block->next != NULL)
+  {
+    block->next->prev = block->prev;
+  }
+
+  if(block->mapped_size == 0)
+  {
+    free(block);
+  }
+  else
+  {
+    /* The pages may get mapped again at the same address, where poisoned
+       parts of the block would remain poisoned. */
+    ASAN_UNPOISON_MEMORY_REGION(block, block->mapped_size);
+    CR_PageFree(block, block->mapped_size);
+  }
+}
+
+/** Frees all tracked blocks of the given region which have a serial not
+  smaller than the specified one. */
+static void freeTrackedBlocksSince(CR_Region *r, size_t serial)
+{
+  while(r->tracked_blocks != NULL && r->tracked_blocks->serial >= serial)
+  {
+    freeTrackedBlock(r, r->tracked_blocks);
   }
 }
 
@@ -218,13 +562,71 @@ static void *allocFromChunk(CR_Region *r, Chunk *chunk, size_t size)
 */
 static void *allocFromChunkWithPadding(CR_Region *r, size_t size)
 {
-  const size_t padding =
-    (alignment - (size & (alignment - 1))) & (alignment - 1);
+  return allocFromChunk(r, &r->head.aligned,
+                        CR_SafeAdd(size, getPadding(size, alignment)));
+}
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+/** Like allocFromChunkWithPadding(), but aligns the returned memory to the
+  given boundary.
+
+  @param r Region from which should be allocated.
+  @param size Amount of bytes to allocate.
+  @param boundary A power of two larger than the default alignment.
+
+  @return Allocated memory. Will never be NULL.
+*/
+static void *allocFromChunkWithBoundary(CR_Region *r, size_t size,
+                                        size_t boundary)
+{
+  if(size == 0)
+  {
+    CR_ExitFailure("unable to allocate 0 bytes");
+  }
+
+  Chunk *chunk = &r->head.aligned;
+  const size_t padded_size = CR_SafeAdd(size, getPadding(size, alignment));
 
-  return allocFromChunk(r, &r->aligned, CR_SafeAdd(size, padding));
+  const size_t offset =
+    getPadding((uintptr_t)&chunk->chunk[chunk->bytes_used], boundary);
+  const size_t bytes_left = chunk->capacity - chunk->bytes_used;
+  if(offset <= bytes_left && padded_size <= bytes_left - offset)
+  {
+    chunk->bytes_used += offset;
+    return popBytesFromChunk(chunk, padded_size);
+  }
+
+  /* Allocate enough space for the worst case and give unneeded bytes back
+     to the chunk, if possible. */
+  const size_t worst_case_size =
+    CR_SafeAdd(padded_size, boundary - alignment);
+  unsigned char *data = allocFromChunk(r, chunk, worst_case_size);
+  unsigned char *aligned_data =
+    &data[getPadding((uintptr_t)data, boundary)];
+
+  if(&data[worst_case_size] == &chunk->chunk[chunk->bytes_used])
+  {
+    chunk->bytes_used =
+      (size_t)(&aligned_data[padded_size] - chunk->chunk);
+  }
+
+  return aligned_data;
 }
+#endif
 
 #ifdef CREGION_ALWAYS_FRESH_MALLOC
+/** Wrapper around malloc which handles returned NULL pointers. */
+static void *checkedMalloc(size_t size)
+{
+  void *data = malloc(size);
+  if(data == NULL)
+  {
+    CR_ExitFailure("failed to allocate %zu bytes", size);
+  }
+
+  return data;
+}
+
 /** Allocate memory using malloc() and attach its lifetime to the given
   region.
 
@@ -263,23 +665,290 @@ static void *rawMallocWithRegion(CR_Region *r, size_t size)
 */
 void *CR_RegionAlloc(CR_Region *r, size_t size)
 {
+  if(size >= r->head.large_allocation_size)
+  {
+    return allocLarge(r, size, alignment);
+  }
+
 #ifdef CREGION_ALWAYS_FRESH_MALLOC
-  return rawMallocWithRegion(r, size);
+  void *data = rawMallocWithRegion(r, size);
 #else
-  return allocFromChunkWithPadding(r, size);
+  void *data = allocFromChunkWithPadding(r, size);
 #endif
+
+  r->head.aligned.bytes_requested += size;
+  return data;
+}
+
+/** Like CR_RegionAlloc(), but aligns the returned memory to the given
+  boundary. The padding required to align the memory is kept as small as
+  possible.
+
+  @param r The region to use for the allocation.
+  @param size The amount of bytes to allocate.
+  @param boundary The boundary to which the returned memory should be
+  aligned. Must be a power of two not larger than 4096.
+
+  @return A pointer to the allocated memory. Will never be NULL.
+*/
+void *CR_RegionAllocAligned(CR_Region *r, size_t size, size_t boundary)
+{
+  if(boundary == 0 || (boundary & (boundary - 1)) != 0 ||
+     boundary > max_alignment)
+  {
+    CR_ExitFailure("unable to align memory to %zu bytes", boundary);
+  }
+  else if(boundary <= alignment)
+  {
+    return CR_RegionAlloc(r, size);
+  }
+  else if(size >= r->head.large_allocation_size)
+  {
+    return allocLarge(r, size, boundary);
+  }
+
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  if(size == 0)
+  {
+    CR_ExitFailure("unable to allocate 0 bytes");
+  }
+
+  unsigned char *data =
+    rawMallocWithRegion(r, CR_SafeAdd(size, boundary - 1));
+  data = &data[getPadding((uintptr_t)data, boundary)];
+#else
+  void *data = allocFromChunkWithBoundary(r, size, boundary);
+#endif
+
+  r->head.aligned.bytes_requested += size;
+  return data;
 }
 
 /** Like CR_RegionAlloc() but without aligning memory. */
 void *CR_RegionAllocUnaligned(CR_Region *r, size_t size)
+{
+  if(size >= r->head.large_allocation_size)
+  {
+    return allocLarge(r, size, alignment);
+  }
+
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+  void *data = rawMallocWithRegion(r, size);
+#else
+  void *data = allocFromChunk(r, &r->head.unaligned, size);
+#endif
+
+  r->head.unaligned.bytes_requested += size;
+  return data;
+}
+
+/** Grows the given memory in place, if it was the most recent allocation
+  from CR_RegionAlloc() and the regions current chunk has enough space
+  left. Memory grown after creating a savepoint will be partially
+  reclaimed when rolling back to it.
+
+  @param r The region from which the memory was allocated.
+  @param data The memory to grow.
+  @param size The size which was passed to CR_RegionAlloc().
+  @param new_size The requested size, which must not be smaller than the
+  old size.
+
+  @return True if the memory was grown. Otherwise it stays unchanged.
+*/
+bool CR_RegionExtend(CR_Region *r, void *data, size_t size, size_t new_size)
 {
 #ifdef CREGION_ALWAYS_FRESH_MALLOC
-  return rawMallocWithRegion(r, size);
+  (void)r;
+  (void)data;
+  (void)size;
+  (void)new_size;
+  return false;
 #else
-  return allocFromChunk(r, &r->unaligned, size);
+  if(new_size < size || new_size >= r->head.large_allocation_size)
+  {
+    return false;
+  }
+
+  Chunk *chunk = &r->head.aligned;
+  const size_t padded_size = size + getPadding(size, alignment);
+  if(padded_size > chunk->bytes_used ||
+     &chunk->chunk[chunk->bytes_used - padded_size] != data)
+  {
+    return false;
+  }
+
+  const size_t growth = new_size + getPadding(new_size, alignment) - padded_size;
+  if(growth > chunk->capacity - chunk->bytes_used)
+  {
+    return false;
+  }
+
+  chunk->bytes_used += growth;
+  chunk->bytes_requested += new_size - size;
+  return true;
 #endif
 }
 
+/** Frees a large allocation before its region gets released. The memory
+  will be returned to the operating system immediately.
+
+  @param r The region from which the memory was allocated.
+  @param data Memory of at least the regions large allocation size, which
+  was returned by CR_RegionAlloc(), CR_RegionAllocAligned() or
+  CR_RegionAllocUnaligned(). See CR_RegionOptions for details.
+*/
+void CR_RegionFreeLarge(CR_Region *r, void *data)
+{
+  LargeAllocation *allocation = (LargeAllocation *)data - 1;
+  if(allocation->r != r)
+  {
+    CR_ExitFailure("passed invalid pointer to CR_RegionFreeLarge()");
+  }
+
+  freeLarge(r, allocation);
+}
+
+/** Binds the given block to the lifetime of the specified region. It will
+  be freed when the region gets released or reset, or when rolling back
+  to a savepoint created before this function was called. This is much
+  cheaper than attaching a callback for each block.
+
+  @param r The region which should free the block.
+  @param block A block allocated via malloc() or CR_PageAlloc(). Its
+  members will be initialized by this function.
+  @param mapped_size The size passed to CR_PageAlloc(), or 0 if the block
+  was allocated via malloc().
+*/
+void CR_RegionTrackBlock(CR_Region *r, CR_RegionBlock *block,
+                         size_t mapped_size)
+{
+  block->r = r;
+  block->serial = r->next_large_serial;
+  r->next_large_serial++;
+  block->mapped_size = mapped_size;
+
+  block->prev = NULL;
+  block->next = r->tracked_blocks;
+  if(r->tracked_blocks != NULL)
+  {
+    r->tracked_blocks->prev = block;
+  }
+  r->tracked_blocks = block;
+}
+
+/** Assigns the given block its place in the order of creation, without
+  tracking it yet. This allows tracking memory later on, which should not
+  be freed when rolling back to savepoints created in between.
+
+  @param r The region which may track the block later.
+  @param block The block to reserve. Its members will be initialized by
+  this function.
+*/
+void CR_RegionReserveBlock(CR_Region *r, CR_RegionBlock *block)
+{
+  block->r = r;
+  block->prev = NULL;
+  block->next = NULL;
+  block->serial = r->next_large_serial;
+  r->next_large_serial++;
+  block->mapped_size = 0;
+}
+
+/** Like CR_RegionTrackBlock(), but keeps the place of a block reserved via
+  CR_RegionReserveBlock(). Rolling back to a savepoint created after the
+  reservation will not free the block.
+
+  @param block A copy of the reserved block, at the start of memory
+  allocated via malloc() or CR_PageAlloc().
+  @param mapped_size The size passed to CR_PageAlloc(), or 0 if the block
+  was allocated via malloc().
+*/
+void CR_RegionTrackReservedBlock(CR_RegionBlock *block, size_t mapped_size)
+{
+  CR_Region *r = block->r;
+  /* Without savepoints in between, the block can be tracked like a new
+     one. */
+  if(block->serial >= r->last_mark_serial)
+  {
+    CR_RegionTrackBlock(r, block, mapped_size);
+    return;
+  }
+
+  /* Keep the list sorted by serial, for freeTrackedBlocksSince(). */
+  CR_RegionBlock *prev = NULL;
+  CR_RegionBlock *next = r->tracked_blocks;
+  while(next != NULL && next->serial > block->serial)
+  {
+    prev = next;
+    next = next->next;
+  }
+
+  block->mapped_size = mapped_size;
+  block->prev = prev;
+  block->next = next;
+  if(prev == NULL)
+  {
+    r->tracked_blocks = block;
+  }
+  else
+  {
+    prev->next = block;
+  }
+  if(next != NULL)
+  {
+    next->prev = block;
+  }
+}
+
+/** Returns true if a savepoint was created after the given block got its
+  place in the order of creation.
+
+  @param block A block passed to CR_RegionReserveBlock() or
+  CR_RegionTrackBlock().
+*/
+bool CR_RegionMarkedSince(const CR_RegionBlock *block)
+{
+  return block->r->last_mark_serial > block->serial;
+}
+
+/** Updates the region of a tracked block which got moved to another
+  address, e.g. by realloc(). The block keeps its position in the order
+  of creation.
+
+  @param block The new address of the block, which must contain a copy of
+  its previous members.
+  @param mapped_size The new size of the pages containing the block, or 0
+  if it was allocated via malloc().
+*/
+void CR_RegionMoveBlock(CR_RegionBlock *block, size_t mapped_size)
+{
+  block->mapped_size = mapped_size;
+
+  if(block->prev == NULL)
+  {
+    block->r->tracked_blocks = block;
+  }
+  else
+  {
+    block->prev->next = block;
+  }
+
+  if(block->next != NULL)
+  {
+    block->next->prev = block;
+  }
+}
+
+/** Frees a tracked block before its region gets released.
+
+  @param block A block passed to CR_RegionTrackBlock() or
+  CR_RegionMoveBlock().
+*/
+void CR_RegionFreeBlock(CR_RegionBlock *block)
+{
+  freeTrackedBlock(block->r, block);
+}
+
 /** Ensures that the given callback gets called when the specified region
   will be released. Callbacks will be called in reversed order of
   registration. The last registered callback will be called first.
@@ -291,39 +960,370 @@ void *CR_RegionAllocUnaligned(CR_Region *r, size_t size)
 */
 void CR_RegionAttach(CR_Region *r, CR_ReleaseCallback *callback, void *data)
 {
-  /* Store the callback inside the region as the current pending
-     callback. This is required in case the following allocation
-     fails and terminates the program. */
-  r->pending_callback = callback;
-  r->pending_callback_data = data;
+  CallbackBlock *block = r->callbacks;
+  if(block == NULL || block->count == callbacks_per_block)
+  {
+    /* Store the callback inside the region as the current pending
+       callback. This is required in case the following allocation
+       fails and terminates the program. */
+    r->pending_callback = callback;
+    r->pending_callback_data = data;
 
-  CallbackList *element = allocFromChunkWithPadding(r, sizeof *element);
+    block = CR_ChunkCacheAlloc(callback_block_size);
+    addOwnedBytes(r, callback_block_size);
 
-  r->pending_callback = NULL;
-  r->pending_callback_data = NULL;
+    r->pending_callback = NULL;
+    r->pending_callback_data = NULL;
 
-  /* Prepend the callback to the regions callback-list. */
-  element->callback = callback;
-  element->data = data;
+    block->prev = r->callbacks;
+    block->count = 0;
+    r->callbacks = block;
+  }
 
-  element->next = r->callback_list;
-  r->callback_list = element;
+  block->callbacks[block->count].callback = callback;
+  block->callbacks[block->count].data = data;
+  block->count++;
 }
 
-/** Frees the given region and calls all attached callbacks. */
-void CR_RegionRelease(CR_Region *r)
+/** Calls all callbacks attached to the given region after the specified
+  position in reversed order and removes them.
+
+  @param r The region containing the callbacks.
+  @param stop_block The block containing the last callback which should
+  not be called. If NULL, all callbacks will be called.
+  @param stop_count The amount of callbacks in stop_block which should
+  not be called.
+*/
+static void callCallbacksUntil(CR_Region *r, CallbackBlock *stop_block,
+                               size_t stop_count)
+{
+  while(r->callbacks != NULL)
+  {
+    CallbackBlock *block = r->callbacks;
+    const size_t stop = (block == stop_block) ? stop_count : 0;
+
+    while(block->count > stop)
+    {
+      block->count--;
+      const Callback *element = &block->callbacks[block->count];
+      element->callback(element->data);
+    }
+
+    if(block == stop_block)
+    {
+      return;
+    }
+
+    r->callbacks = block->prev;
+    r->bytes_owned -= callback_block_size;
+    CR_ChunkCacheFree(block, callback_block_size);
+  }
+}
+
+/** Calls and clears all callbacks attached to the given region. */
+static void callAttachedCallbacks(CR_Region *r)
 {
-  /* Call all attached callbacks. */
   if(r->pending_callback != NULL)
   {
     r->pending_callback(r->pending_callback_data);
+    r->pending_callback = NULL;
+    r->pending_callback_data = NULL;
   }
-  for(CallbackList *element = r->callback_list;
+
+  callCallbacksUntil(r, NULL, 0);
+}
+
+/** Captures the current allocation state of the given region. Passing the
+  returned savepoint to CR_RegionRollback() releases everything allocated
+  and attached after this call.
+
+  @param r The region to mark.
+
+  @return A savepoint, which is allocated from the region itself. It stays
+  valid until the region gets reset, released, or rolled back to an older
+  savepoint.
+*/
+CR_RegionSavepoint *CR_RegionMark(CR_Region *r)
+{
+  /* The savepoint is allocated before capturing the state of the region,
+     to survive rollbacks. */
+  CR_RegionSavepoint *mark = allocFromChunkWithPadding(r, sizeof *mark);
+
+  mark->aligned = r->head.aligned;
+  mark->unaligned = r->head.unaligned;
+  mark->chunk_list = r->chunk_list;
+  mark->callbacks = r->callbacks;
+  mark->callback_count = r->callbacks == NULL ? 0 : r->callbacks->count;
+  mark->next_large_serial = r->next_large_serial;
+  r->last_mark_serial = r->next_large_serial;
+  mark->bytes_wasted = r->bytes_wasted;
+
+  return mark;
+}
+
+/** Reverts the given region to the state captured by CR_RegionMark(). All
+  callbacks attached after creating the savepoint will be called and all
+  chunks allocated since then will be freed. The savepoint stays valid and
+  can be rolled back to again.
+
+  @param r The region to roll back.
+  @param mark A savepoint returned by CR_RegionMark() for the same region.
+*/
+void CR_RegionRollback(CR_Region *r, CR_RegionSavepoint *mark)
+{
+  callCallbacksUntil(r, mark->callbacks, mark->callback_count);
+  freeLargeAllocationsSince(r, mark->next_large_serial);
+  freeTrackedBlocksSince(r, mark->next_large_serial);
+
+  while(r->chunk_list != mark->chunk_list)
+  {
+    ChunkList *element = r->chunk_list;
+    r->chunk_list = element->next;
+    freeChunk(r, element);
+  }
+
+  r->head.aligned = mark->aligned;
+  r->head.unaligned = mark->unaligned;
+  r->bytes_wasted = mark->bytes_wasted;
+}
+
+/** Returns the chunk-list element which contains the given region. */
+static ChunkList *getFirstChunk(CR_Region *r)
+{
+  return (ChunkList *)r - 1;
+}
+
+/** Returns true if the given chunk points into the regions first chunk. */
+static bool isPartOfFirstChunk(CR_Region *r, const Chunk *chunk)
+{
+  unsigned char *first_chunk = (unsigned char *)getFirstChunk(r);
+  return chunk->chunk == first_chunk ||
+    chunk->chunk == &first_chunk[r->first_chunk_split];
+}
+
+/** Decides whether CR_RegionReset() should keep the given chunk.
+
+  @param r The region to which the chunk belongs.
+  @param chunk The chunk to check.
+  @param budget The amount of bytes which may still be kept. Will be
+  reduced by the capacity of the chunk, if it gets kept.
+
+  @return True if the chunk should be kept.
+*/
+static bool retainChunk(CR_Region *r, const Chunk *chunk, size_t *budget)
+{
+  if(isPartOfFirstChunk(r, chunk) || chunk->capacity > *budget)
+  {
+    return false;
+  }
+
+  *budget -= chunk->capacity;
+  return true;
+}
+
+/** Rewinds the given chunk if it should be kept, otherwise it gets
+  reverted to its half of the regions first chunk.
+
+  @param chunk The chunk to rewind.
+  @param keep True if the chunk should be kept.
+  @param first_chunk_part The part of the first chunk to revert to.
+  @param first_chunk_bytes_used The amount of bytes in the first chunk
+  occupied by the region itself.
+  @param first_chunk_capacity The capacity of the first chunks part.
+  @param second_chunk_size The size of the chunk following the first
+  chunk.
+*/
+static void rewindChunk(Chunk *chunk, bool keep,
+                        unsigned char *first_chunk_part,
+                        size_t first_chunk_bytes_used,
+                        size_t first_chunk_capacity,
+                        size_t second_chunk_size)
+{
+  chunk->bytes_requested = 0;
+
+  if(keep)
+  {
+    chunk->bytes_used = sizeof(ChunkList);
+  }
+  else
+  {
+    chunk->chunk = first_chunk_part;
+    chunk->bytes_used = first_chunk_bytes_used;
+    chunk->capacity = first_chunk_capacity;
+    chunk->next_chunk_size = second_chunk_size;
+  }
+}
+
+/** Calls all callbacks attached to the given region and releases all its
+  memory, without destroying the region itself. The largest chunks of the
+  region will be kept for reuse, as long as their total size does not
+  exceed the limit set via CR_RegionSetRetainLimit(). This allows reusing
+  a region over and over again without calling malloc() and free().
+
+  @param r The region to reset. All memory previously allocated from it
+  becomes invalid.
+*/
+void CR_RegionReset(CR_Region *r)
+{
+  callAttachedCallbacks(r);
+  freeLargeAllocationsSince(r, 0);
+  freeTrackedBlocksSince(r, 0);
+
+  /* The first chunk contains the region and is always kept. The current
+     chunks are kept as long as they fit into the limit, larger ones
+     first. */
+  size_t budget = r->retain_limit;
+  bool keep_aligned;
+  bool keep_unaligned;
+  if(r->head.aligned.capacity >= r->head.unaligned.capacity)
+  {
+    keep_aligned = retainChunk(r, &r->head.aligned, &budget);
+    keep_unaligned = retainChunk(r, &r->head.unaligned, &budget);
+  }
+  else
+  {
+    keep_unaligned = retainChunk(r, &r->head.unaligned, &budget);
+    keep_aligned = retainChunk(r, &r->head.aligned, &budget);
+  }
+
+  /* Free all other chunks. */
+  ChunkList *first_chunk = getFirstChunk(r);
+  ChunkList *element = r->chunk_list;
+  r->chunk_list = first_chunk;
+  while(element != first_chunk)
+  {
+    ChunkList *next = element->next;
+    if((keep_aligned && element == (ChunkList *)r->head.aligned.chunk) ||
+       (keep_unaligned && element == (ChunkList *)r->head.unaligned.chunk))
+    {
+      element->next = r->chunk_list;
+      r->chunk_list = element;
+    }
+    else
+    {
+      freeChunk(r, element);
+    }
+    element = next;
+  }
+
+  unsigned char *first_aligned = (unsigned char *)first_chunk;
+  rewindChunk(&r->head.aligned, keep_aligned, first_aligned,
+              (sizeof *first_chunk) + (sizeof *r), r->first_chunk_split,
+              r->second_chunk_size);
+  rewindChunk(&r->head.unaligned, keep_unaligned,
+              &first_aligned[r->first_chunk_split], 0,
+              first_chunk->size - r->first_chunk_split,
+              r->second_chunk_size);
+
+  /* All savepoints became invalid. */
+  r->last_mark_serial = 0;
+
+  /* Parts of the first chunk which got replaced by kept chunks are not
+     allocated from anymore. */
+  r->bytes_wasted = 0;
+  if(keep_aligned)
+  {
+    r->bytes_wasted +=
+      r->first_chunk_split - (sizeof *first_chunk) - (sizeof *r);
+  }
+  if(keep_unaligned)
+  {
+    r->bytes_wasted += first_chunk->size - r->first_chunk_split;
+  }
+}
+
+/** Limits the amount of memory which CR_RegionReset() may keep for reuse.
+  By default there is no limit.
+
+  @param r The region to configure.
+  @param limit The maximum amount of bytes to keep. If 0, the region will
+  shrink back to its initial size on every reset.
+*/
+void CR_RegionSetRetainLimit(CR_Region *r, size_t limit)
+{
+  r->retain_limit = limit;
+}
+
+/** Returns the size class of the given chunk size for CR_RegionStats. */
+static size_t getChunkSizeClass(size_t size)
+{
+  size_t index = 0;
+  for(size_t class_size = first_chunk_size;
+      class_size < size && index < CR_REGION_SIZE_CLASS_COUNT - 1;
+      class_size <<= 1)
+  {
+    index++;
+  }
+
+  return index;
+}
+
+/** Collects statistics about the memory usage of the given region. The
+  statistics only cover the current state of the region: rolling back or
+  resetting it also reverts them, except for the high-water mark.
+
+  @param r The region to inspect.
+  @param stats The struct to fill. See CR_RegionStats for details.
+*/
+void CR_RegionGetStats(CR_Region *r, CR_RegionStats *stats)
+{
+  stats->bytes_requested =
+    r->head.aligned.bytes_requested + r->head.unaligned.bytes_requested;
+  stats->bytes_wasted = r->bytes_wasted;
+  stats->bytes_free = (r->head.aligned.capacity - r->head.aligned.bytes_used) +
+    (r->head.unaligned.capacity - r->head.unaligned.bytes_used);
+  stats->high_water_mark = r->bytes_owned_peak;
+
+  stats->chunk_count = 0;
+  stats->chunk_bytes = 0;
+  for(size_t index = 0; index < CR_REGION_SIZE_CLASS_COUNT; index++)
+  {
+    stats->chunk_counts[index] = 0;
+  }
+  for(ChunkList *element = r->chunk_list;
       element != NULL; element = element->next)
   {
-    element->callback(element->data);
+    stats->chunk_count++;
+    stats->chunk_bytes += element->size;
+    stats->chunk_counts[getChunkSizeClass(element->size)]++;
   }
 
+  /* Everything which is not bookkeeping, wasted or free got handed out. */
+  stats->bytes_used = stats->chunk_bytes -
+    stats->chunk_count * sizeof(ChunkList) - sizeof(CR_Region) -
+    stats->bytes_wasted - stats->bytes_free;
+
+  stats->large_allocation_count = 0;
+  stats->large_allocation_bytes = 0;
+  for(LargeAllocation *allocation = r->large_allocations;
+      allocation != NULL; allocation = allocation->next)
+  {
+    stats->large_allocation_count++;
+    stats->large_allocation_bytes += allocation->bytes_requested;
+  }
+
+  stats->tracked_block_count = 0;
+  for(CR_RegionBlock *block = r->tracked_blocks;
+      block != NULL; block = block->next)
+  {
+    stats->tracked_block_count++;
+  }
+
+  stats->callback_count = 0;
+  for(CallbackBlock *block = r->callbacks;
+      block != NULL; block = block->prev)
+  {
+    stats->callback_count += block->count;
+  }
+}
+
+/** Frees the given region and calls all attached callbacks. */
+void CR_RegionRelease(CR_Region *r)
+{
+  callAttachedCallbacks(r);
+  freeLargeAllocationsSince(r, 0);
+  freeTrackedBlocksSince(r, 0);
+
   /* Detach the region from the region-list. */
   if(r->prev != NULL)
   {
@@ -343,7 +1343,7 @@ void CR_RegionRelease(CR_Region *r)
   while(element != NULL)
   {
     ChunkList *next = element->next;
-    free(element);
+    CR_ChunkCacheFree(element, element->size);
     element = next;
   }
 }
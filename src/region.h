@@ -5,18 +5,240 @@
 #ifndef CREGION_SRC_REGION_H
 #define CREGION_SRC_REGION_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 typedef struct CR_Region CR_Region;
 
+/** A savepoint for reverting a region to a previous state. */
+typedef struct CR_RegionSavepoint CR_RegionSavepoint;
+
 /** A callback function type, which will be called when a region gets
   released. This callback should never call exit(). */
 typedef void CR_ReleaseCallback(void *data);
 
+/** Options for creating regions via CR_RegionNewWithOptions(). Members
+  which are zero will be replaced by their default values. */
+typedef struct
+{
+  /** The size of the first chunk, which also contains the region itself.
+    Defaults to 1024 bytes. */
+  size_t initial_capacity;
+
+  /** The part of the first chunk used by CR_RegionAlloc() in percent. The
+    rest will be used by CR_RegionAllocUnaligned(). Defaults to 50. */
+  size_t aligned_percent;
+
+  /** The factor by which the size of each subsequent chunk grows.
+    Defaults to 2. */
+  size_t growth_factor;
+
+  /** The size which chunks will not grow beyond. Larger allocations get
+    their own chunk. Defaults to no limit. */
+  size_t max_chunk_size;
+
+  /** Allocations of at least this size get their own pages from the
+    operating system and can be freed individually via
+    CR_RegionFreeLarge(). Defaults to 256 KiB. */
+  size_t large_allocation_size;
+}CR_RegionOptions;
+
+/** The amount of chunk size classes in CR_RegionStats. */
+#define CR_REGION_SIZE_CLASS_COUNT 32
+
+/** Statistics about the memory usage of a region, as returned by
+  CR_RegionGetStats(). In builds with CREGION_ALWAYS_FRESH_MALLOC, memory
+  allocated via malloc() is only reflected in bytes_requested. */
+typedef struct
+{
+  /** The sum of all sizes passed to the allocation functions of the
+    region, excluding large allocations. */
+  size_t bytes_requested;
+
+  /** The amount of bytes handed out from chunks, including padding and
+    internal allocations like savepoints. */
+  size_t bytes_used;
+
+  /** The amount of unused bytes at the end of chunks which the region
+    stopped allocating from. */
+  size_t bytes_wasted;
+
+  /** The amount of unused bytes in the chunks currently allocated from. */
+  size_t bytes_free;
+
+  /** The amount and total size of all chunks owned by the region. */
+  size_t chunk_count;
+  size_t chunk_bytes;
+
+  /** The amount of chunks by size. Class 0 contains chunks of up to 1024
+    bytes and each subsequent class contains chunks of up to twice the
+    size. The last class also contains all larger chunks. */
+  size_t chunk_counts[CR_REGION_SIZE_CLASS_COUNT];
+
+  /** The amount of large allocations and the sum of their sizes. */
+  size_t large_allocation_count;
+  size_t large_allocation_bytes;
+
+  /** The amount of callbacks attached to the region. */
+  size_t callback_count;
+
+  /** The amount of blocks tracked via CR_RegionTrackBlock(). */
+  size_t tracked_block_count;
+
+  /** The largest amount of memory the region ever owned, including
+    chunks, large allocations and callback storage. */
+  size_t high_water_mark;
+}CR_RegionStats;
+
+/** The state of a chunk from which a region allocates. This is only
+  exposed for CR_RegionAllocInline() and should not be accessed
+  directly. */
+typedef struct
+{
+  unsigned char *chunk; /**< Allocated bytes. */
+  size_t bytes_used; /**< The amount of used bytes in the chunk. */
+  size_t capacity; /**< The total capacity of the chunk. */
+  size_t next_chunk_size; /**< The size of the next chunk. */
+
+  /** The sum of all sizes requested from this and previous chunks of the
+    same kind. */
+  size_t bytes_requested;
+}CR_RegionChunk;
+
+/** The part of a region used by CR_RegionAllocInline(). It is the first
+  member of every region and should not be accessed directly. */
+typedef struct
+{
+  CR_RegionChunk aligned; /**< Chunk for aligned memory. */
+  CR_RegionChunk unaligned; /**< Chunk for unaligned memory. */
+
+  /** The size from which allocations become large allocations. */
+  size_t large_allocation_size;
+}CR_RegionHead;
+
+/** A node stored at the start of a memory block which is not allocated
+  from a region, but released together with it. This allows binding
+  blocks to a region without attaching a callback to each of them. Its
+  members are managed by the region and should not be accessed
+  directly. */
+typedef struct CR_RegionBlock CR_RegionBlock;
+struct CR_RegionBlock
+{
+  /** The region which tracks or reserved this block. */
+  CR_Region *r;
+
+  /** The previous and next blocks tracked by the same region. */
+  CR_RegionBlock *prev, *next;
+
+  /** The number of this block in the order of creation. Allows savepoints
+    to find all blocks tracked after them. */
+  size_t serial;
+
+  /** The size of the pages containing the block, or 0 if the block was
+    allocated via malloc(). */
+  size_t mapped_size;
+};
+
 extern CR_Region *CR_RegionNew(void);
+extern CR_Region *CR_RegionNewWithOptions(const CR_RegionOptions *options);
 extern void *CR_RegionAlloc(CR_Region *r, size_t size);
+extern void *CR_RegionAllocAligned(CR_Region *r, size_t size, size_t boundary);
 extern void *CR_RegionAllocUnaligned(CR_Region *r, size_t size);
+extern bool CR_RegionExtend(CR_Region *r, void *data, size_t size,
+                            size_t new_size);
+extern void CR_RegionFreeLarge(CR_Region *r, void *data);
+extern void CR_RegionTrackBlock(CR_Region *r, CR_RegionBlock *block,
+                                size_t mapped_size);
+extern void CR_RegionReserveBlock(CR_Region *r, CR_RegionBlock *block);
+extern void CR_RegionTrackReservedBlock(CR_RegionBlock *block,
+                                        size_t mapped_size);
+extern bool CR_RegionMarkedSince(const CR_RegionBlock *block);
+extern void CR_RegionMoveBlock(CR_RegionBlock *block, size_t mapped_size);
+extern void CR_RegionFreeBlock(CR_RegionBlock *block);
 extern void CR_RegionAttach(CR_Region *r, CR_ReleaseCallback *callback, void *data);
+extern CR_RegionSavepoint *CR_RegionMark(CR_Region *r);
+extern void CR_RegionRollback(CR_Region *r, CR_RegionSavepoint *mark);
+extern void CR_RegionReset(CR_Region *r);
+extern void CR_RegionSetRetainLimit(CR_Region *r, size_t limit);
+extern void CR_RegionGetStats(CR_Region *r, CR_RegionStats *stats);
 extern void CR_RegionRelease(CR_Region *r);
 
+/** Pops the given amount of bytes from the chunk, if it has enough space
+  left. Otherwise NULL will be returned.
+
+  @param chunk The chunk to allocate from.
+  @param size The amount of bytes to allocate.
+  @param padded_size The size rounded up to the chunks alignment. Can be
+  smaller than size on overflows.
+*/
+static inline void *CR_RegionChunkPop(CR_RegionChunk *chunk, size_t size,
+                                      size_t padded_size)
+{
+  const size_t bytes_left = chunk->capacity - chunk->bytes_used;
+
+  /* A size of 0 wraps around and gets rejected. If size fits, padded_size
+     can not overflow. */
+  if(size - 1 < bytes_left && padded_size <= bytes_left)
+  {
+    void *data = &chunk->chunk[chunk->bytes_used];
+    chunk->bytes_used += padded_size;
+    chunk->bytes_requested += size;
+    return data;
+  }
+
+  return NULL;
+}
+
+/** Returns the head of the given region, which is its first member. */
+static inline CR_RegionHead *CR_RegionGetHead(CR_Region *r)
+{
+  return (CR_RegionHead *)(void *)r;
+}
+
+/** Returns true if the given size is too small to become a large
+  allocation in the specified region. */
+static inline bool CR_RegionIsSmallAllocation(CR_Region *r, size_t size)
+{
+  return size < CR_RegionGetHead(r)->large_allocation_size;
+}
+
+/** Like CR_RegionAlloc(), but gets inlined into the caller. It only calls
+  into the region implementation if the current chunk is exhausted, or if
+  an error must be handled. */
+static inline void *CR_RegionAllocInline(CR_Region *r, size_t size)
+{
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  CR_RegionChunk *aligned = &CR_RegionGetHead(r)->aligned;
+  if(CR_RegionIsSmallAllocation(r, size))
+  {
+    void *data = CR_RegionChunkPop(aligned, size, (size + 7) & ~(size_t)7);
+    if(data != NULL)
+    {
+      return data;
+    }
+  }
+#endif
+
+  return CR_RegionAlloc(r, size);
+}
+
+/** Like CR_RegionAllocUnaligned(), but gets inlined into the caller. See
+  CR_RegionAllocInline() for details. */
+static inline void *CR_RegionAllocUnalignedInline(CR_Region *r, size_t size)
+{
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  CR_RegionChunk *unaligned = &CR_RegionGetHead(r)->unaligned;
+  if(CR_RegionIsSmallAllocation(r, size))
+  {
+    void *data = CR_RegionChunkPop(unaligned, size, size);
+    if(data != NULL)
+    {
+      return data;
+    }
+  }
+#endif
+
+  return CR_RegionAllocUnaligned(r, size);
+}
+
 #endif
@@ -105,6 +105,8 @@ static void testFailure(unsigned char *ptr)
 {
   assert_error((ptr = CR_EnsureCapacity(ptr, 0)),
                "unable to allocate 0 bytes");
+  assert_error((ptr = CR_ShrinkToFit(ptr, 0)),
+               "unable to allocate 0 bytes");
 }
 
 static void testOverflow(unsigned char *ptr)
@@ -113,6 +115,41 @@ static void testOverflow(unsigned char *ptr)
                "overflow calculating object size");
 }
 
+/** Appends the given amount of bytes one by one to growable memory with
+  the specified growth percentage.
+
+  @return The amount of times the capacity of the memory changed.
+*/
+static size_t appendBytes(size_t bytes, size_t growth_percent)
+{
+  CR_Region *r = CR_RegionNew();
+  unsigned char *ptr = CR_RegionAllocGrowable(r, 1);
+  CR_SetGrowthPercent(ptr, growth_percent);
+  ptr[0] = 0;
+
+  size_t capacity_changes = 0;
+  for(size_t size = 2; size <= bytes; size++)
+  {
+    const size_t capacity = CR_GetCapacity(ptr);
+    ptr = CR_EnsureCapacity(ptr, size);
+    assert_true(CR_GetCapacity(ptr) >= size);
+    if(CR_GetCapacity(ptr) != capacity)
+    {
+      capacity_changes++;
+    }
+
+    ptr[size - 1] = (unsigned char)size;
+  }
+
+  for(size_t size = 2; size <= bytes; size++)
+  {
+    assert_true(ptr[size - 1] == (unsigned char)size);
+  }
+
+  CR_RegionRelease(r);
+  return capacity_changes;
+}
+
 static void invokeTestFunction(PtrTestFunction *function)
 {
   testFromRegion(1, function);
@@ -143,6 +180,312 @@ int main(void)
   }
   testGroupEnd();
 
+  testGroupStart("growing memory geometrically");
+  {
+    CR_Region *r = CR_RegionNew();
+    unsigned char *ptr = CR_RegionAllocGrowable(r, 100);
+    assert_true(CR_GetCapacity(ptr) == 100);
+
+    ptr = CR_EnsureCapacity(ptr, 101);
+    assert_true(CR_GetCapacity(ptr) == 150);
+    ptr = CR_EnsureCapacity(ptr, 500);
+    assert_true(CR_GetCapacity(ptr) == 500);
+
+    CR_SetGrowthPercent(ptr, 100);
+    ptr = CR_EnsureCapacity(ptr, 501);
+    assert_true(CR_GetCapacity(ptr) == 1000);
+
+    assert_error(CR_SetGrowthPercent(ptr, 1001),
+                 "growth percentage of 1001 is larger than 1000");
+    CR_RegionRelease(r);
+
+    assert_true(appendBytes(100000, 0) == 99999);
+    assert_true(appendBytes(100000, 50) < 40);
+    assert_true(appendBytes(100000, 100) == 17);
+    assert_true(appendBytes(100000, 1000) < 10);
+  }
+  testGroupEnd();
+
+  testGroupStart("storing small memory inside regions");
+  {
+    CR_Region *r = CR_RegionNew();
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    CR_RegionStats stats;
+    CR_RegionGetStats(r, &stats);
+    const size_t callback_count = stats.callback_count;
+#endif
+
+    for(size_t index = 0; index < 100; index++)
+    {
+      unsigned char *ptr = CR_RegionAllocGrowable(r, sRand() % 64 + 1);
+      checkPtr(ptr);
+      ptr[0] = 0x71;
+    }
+
+    unsigned char *ptr = CR_RegionAllocGrowable(r, 16);
+    memset(ptr, 0x2E, 16);
+    unsigned char *grown_ptr = CR_EnsureCapacity(ptr, 100);
+    checkPtr(grown_ptr);
+    assertPtrContainsValue(grown_ptr, 16, 0x2E);
+    memset(grown_ptr, 0x2E, 100);
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    /* The most recent allocation grows in place without touching the
+       heap. */
+    assert_true(grown_ptr == ptr);
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.callback_count == callback_count);
+#endif
+
+    /* Memory which can't grow in place moves to the heap, instead of
+       being copied inside the region. */
+    (void)CR_RegionAlloc(r, 8);
+    ptr = CR_EnsureCapacity(grown_ptr, 120);
+    checkPtr(ptr);
+    assertPtrContainsValue(ptr, 100, 0x2E);
+    memset(ptr, 0x2E, 120);
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.tracked_block_count == 1);
+#endif
+
+    ptr = CR_EnsureCapacity(ptr, 200);
+    checkPtr(ptr);
+    assertPtrContainsValue(ptr, 120, 0x2E);
+    memset(ptr, 0x2E, 200);
+
+    ptr = CR_EnsureCapacity(ptr, 5000);
+    checkPtr(ptr);
+    assertPtrContainsValue(ptr, 200, 0x2E);
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.callback_count == callback_count);
+    assert_true(stats.tracked_block_count == 1);
+#endif
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("growing small memory across savepoints");
+  {
+    /* Leave enough space in the first chunk for growing in place. */
+    CR_RegionOptions options = { 0 };
+    options.initial_capacity = 4096;
+    CR_Region *r = CR_RegionNewWithOptions(&options);
+    unsigned char *ptr = CR_RegionAllocGrowable(r, 16);
+    memset(ptr, 'A', 16);
+
+    CR_RegionSavepoint *mark = CR_RegionMark(r);
+    unsigned char *new_ptr = CR_RegionAllocGrowable(r, 16);
+    memset(new_ptr, 'C', 16);
+    unsigned char *grown_ptr = CR_EnsureCapacity(new_ptr, 32);
+    checkPtr(grown_ptr);
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    /* Memory allocated after the savepoint still grows in place. */
+    assert_true(grown_ptr == new_ptr);
+#endif
+
+    ptr = CR_EnsureCapacity(ptr, 32);
+    checkPtr(ptr);
+    assertPtrContainsValue(ptr, 16, 'A');
+    memset(ptr, 'A', 32);
+
+    /* Rolling back must not affect memory created before the savepoint. */
+    for(size_t round = 0; round < 3; round++)
+    {
+      CR_RegionRollback(r, mark);
+      for(size_t index = 0; index < 20; index++)
+      {
+        memset(CR_RegionAlloc(r, 64), 'B', 64);
+        memset(CR_RegionAllocGrowable(r, 64), 'B', 64);
+      }
+      assertPtrContainsValue(ptr, 32, 'A');
+
+      ptr = CR_EnsureCapacity(ptr, 32 + round * 50);
+      checkPtr(ptr);
+      memset(ptr, 'A', 32 + round * 50);
+    }
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("growing large memory");
+  {
+    CR_Region *r = CR_RegionNew();
+    unsigned char *ptr = CR_RegionAllocGrowable(r, 1000);
+    memset(ptr, 0x4B, 1000);
+
+    size_t size = 1000;
+    while(size < 8 * 1024 * 1024)
+    {
+      const size_t new_size = size + sRand() % (512 * 1024) + 1;
+      ptr = CR_EnsureCapacity(ptr, new_size);
+      checkPtr(ptr);
+      assertPtrContainsValue(ptr, size, 0x4B);
+
+      memset(&ptr[size], 0x4B, new_size - size);
+      size = new_size;
+    }
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("tracking memory in regions");
+  {
+    CR_Region *r = CR_RegionNew();
+    unsigned char *buffers[1000];
+    for(size_t index = 0; index < 1000; index++)
+    {
+      buffers[index] = CR_RegionAllocGrowable(r, 300);
+      checkPtr(buffers[index]);
+      memset(buffers[index], (int)(index % 100), 300);
+    }
+
+    CR_RegionStats stats;
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.tracked_block_count == 1000);
+    assert_true(stats.callback_count == 0);
+
+    /* Moving buffers must not break the list of their region. */
+    for(size_t index = 0; index < 1000; index += 2)
+    {
+      buffers[index] = CR_EnsureCapacity(buffers[index], 3000);
+      checkPtr(buffers[index]);
+      assertPtrContainsValue(buffers[index], 300, (char)(index % 100));
+    }
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.tracked_block_count == 1000);
+
+    /* Rolling back frees only buffers allocated after the savepoint. */
+    CR_RegionSavepoint *mark = CR_RegionMark(r);
+    for(size_t index = 0; index < 100; index++)
+    {
+      (void)CR_RegionAllocGrowable(r, sRand() % 5000 + 300);
+    }
+    buffers[1] = CR_EnsureCapacity(buffers[1], 2 * 1024 * 1024);
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.tracked_block_count == 1100);
+
+    CR_RegionRollback(r, mark);
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.tracked_block_count == 1000);
+    for(size_t index = 0; index < 1000; index++)
+    {
+      assertPtrContainsValue(buffers[index], 300, (char)(index % 100));
+    }
+
+    CR_RegionReset(r);
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.tracked_block_count == 0);
+
+    /* Small memory leaving the region after a savepoint survives rolling
+       back to it, unlike memory allocated after the savepoint. */
+    unsigned char *small_ptr = CR_RegionAllocGrowable(r, 16);
+    memset(small_ptr, 0x1D, 16);
+    (void)CR_RegionAllocGrowable(r, 1000);
+    mark = CR_RegionMark(r);
+    (void)CR_RegionAllocGrowable(r, 1000);
+    small_ptr = CR_EnsureCapacity(small_ptr, 1000);
+    checkPtr(small_ptr);
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.tracked_block_count == 3);
+
+    CR_RegionRollback(r, mark);
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.tracked_block_count == 2);
+    assertPtrContainsValue(small_ptr, 16, 0x1D);
+    memset(small_ptr, 0x1D, 1000);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("shrinking memory");
+  {
+    CR_Region *r = CR_RegionNew();
+
+    unsigned char *small_ptr = CR_RegionAllocGrowable(r, 64);
+    memset(small_ptr, 0x3A, 64);
+    assert_true(CR_ShrinkToFit(small_ptr, 8) == small_ptr);
+    assert_true(CR_GetCapacity(small_ptr) == 64);
+
+    unsigned char *ptr = CR_RegionAllocGrowable(r, 5000);
+    memset(ptr, 0x5C, 5000);
+    assert_true(CR_ShrinkToFit(ptr, 6000) == ptr);
+    assert_true(CR_GetCapacity(ptr) == 5000);
+
+    ptr = CR_ShrinkToFit(ptr, 300);
+    checkPtr(ptr);
+    assert_true(CR_GetCapacity(ptr) == 300);
+    assertPtrContainsValue(ptr, 300, 0x5C);
+
+    /* Large memory gets moved back to the heap. */
+    unsigned char *large_ptr = CR_RegionAllocGrowable(r, 4 * 1024 * 1024);
+    memset(large_ptr, 0x6D, 4 * 1024 * 1024);
+    large_ptr = CR_ShrinkToFit(large_ptr, 2 * 1024 * 1024);
+    checkPtr(large_ptr);
+    assertPtrContainsValue(large_ptr, 2 * 1024 * 1024, 0x6D);
+    large_ptr = CR_ShrinkToFit(large_ptr, 1000);
+    checkPtr(large_ptr);
+    assert_true(CR_GetCapacity(large_ptr) == 1000);
+    assertPtrContainsValue(large_ptr, 1000, 0x6D);
+
+    /* Shrunk memory can grow again. */
+    ptr = CR_EnsureCapacity(ptr, 3000);
+    checkPtr(ptr);
+    assertPtrContainsValue(ptr, 300, 0x5C);
+    assertPtrContainsValue(small_ptr, 64, 0x3A);
+
+    CR_RegionStats stats;
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.tracked_block_count == 2);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("freeing memory");
+  {
+    CR_Region *r = CR_RegionNew();
+    unsigned char *buffers[100];
+    for(size_t index = 0; index < 100; index++)
+    {
+      buffers[index] = CR_RegionAllocGrowable(r, sRand() % 2000 + 300);
+      checkPtr(buffers[index]);
+    }
+    unsigned char *large_ptr = CR_RegionAllocGrowable(r, 2 * 1024 * 1024);
+    memset(large_ptr, 0x2F, 2 * 1024 * 1024);
+
+    CR_FreeGrowable(NULL);
+    CR_FreeGrowable(large_ptr);
+    for(size_t index = 0; index < 100; index += 3)
+    {
+      CR_FreeGrowable(buffers[index]);
+    }
+
+    /* Rolling back must not free memory which was already freed. */
+    CR_RegionSavepoint *mark = CR_RegionMark(r);
+    unsigned char *ptr = CR_RegionAllocGrowable(r, 1000);
+    CR_FreeGrowable(CR_RegionAllocGrowable(r, 1000));
+    memset(ptr, 0x2F, 1000);
+    CR_RegionRollback(r, mark);
+
+    CR_RegionStats stats;
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.tracked_block_count == 66);
+
+    CR_FreeGrowable(buffers[1]);
+    CR_FreeGrowable(buffers[98]);
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.tracked_block_count == 64);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
   testGroupStart("allocation failures");
   {
     assert_error(CR_RegionAllocGrowable(NULL, 0), "unable to allocate 0 bytes");
@@ -0,0 +1,122 @@
+/** @file
+  Tests the chunk cache.
+*/
+
+#include "chunk-cache.h"
+
+#include <stdint.h>
+
+#include "region.h"
+#include "test.h"
+
+/** Wrapper around CR_ChunkCacheAlloc(), which checks the returned
+  memory. */
+static void *checkedChunkAlloc(size_t size)
+{
+  unsigned char *chunk = CR_ChunkCacheAlloc(size);
+  assert_true(chunk != NULL);
+
+  memset(chunk, 0xAB, size);
+  return chunk;
+}
+
+int main(void)
+{
+  testGroupStart("allocating and freeing chunks");
+  {
+    const size_t sizes[] = { 1, 7, 512, 1023, 1024, 1025, 4096, 65536, 300000 };
+    for(size_t index = 0; index < sizeof(sizes)/sizeof(sizes[0]); index++)
+    {
+      void *chunk = checkedChunkAlloc(sizes[index]);
+      CR_ChunkCacheFree(chunk, sizes[index]);
+    }
+    CR_ChunkCacheTrim();
+  }
+  testGroupEnd();
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  testGroupStart("reusing cached chunks");
+  {
+    CR_ChunkCacheTrim();
+
+    void *chunk1 = checkedChunkAlloc(2048);
+    void *chunk2 = checkedChunkAlloc(2048);
+    void *chunk3 = checkedChunkAlloc(8192);
+    CR_ChunkCacheFree(chunk1, 2048);
+    CR_ChunkCacheFree(chunk2, 2048);
+    CR_ChunkCacheFree(chunk3, 8192);
+
+    assert_true(checkedChunkAlloc(8192) == chunk3);
+    assert_true(checkedChunkAlloc(2048) == chunk2);
+    assert_true(checkedChunkAlloc(2048) == chunk1);
+
+    CR_ChunkCacheFree(chunk1, 2048);
+    CR_ChunkCacheFree(chunk2, 2048);
+    CR_ChunkCacheFree(chunk3, 8192);
+    CR_ChunkCacheTrim();
+  }
+  testGroupEnd();
+
+  testGroupStart("limiting the chunk cache");
+  {
+    CR_ChunkCacheSetLimit(4096, 1);
+
+    void *chunk1 = checkedChunkAlloc(4096);
+    void *chunk2 = checkedChunkAlloc(4096);
+    CR_ChunkCacheFree(chunk1, 4096);
+    CR_ChunkCacheFree(chunk2, 4096);
+    assert_true(checkedChunkAlloc(4096) == chunk1);
+    CR_ChunkCacheFree(chunk1, 4096);
+
+    CR_ChunkCacheSetLimit(4096, 0);
+    chunk1 = checkedChunkAlloc(4096);
+    CR_ChunkCacheFree(chunk1, 4096);
+    CR_ChunkCacheSetLimit(4096, 16);
+
+    assert_error(CR_ChunkCacheSetLimit(0, 1), "unable to cache chunks of 0 bytes");
+    assert_error(CR_ChunkCacheSetLimit(512, 1), "unable to cache chunks of 512 bytes");
+    assert_error(CR_ChunkCacheSetLimit(3000, 1), "unable to cache chunks of 3000 bytes");
+  }
+  testGroupEnd();
+
+  testGroupStart("recycling chunks between regions");
+  {
+    CR_ChunkCacheTrim();
+
+    CR_Region *r = CR_RegionNew();
+    void *data = CR_RegionAlloc(r, 8);
+    CR_RegionRelease(r);
+
+    r = CR_RegionNew();
+    assert_true(CR_RegionAlloc(r, 8) == data);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("reusing aligned chunks");
+  {
+    CR_ChunkCacheTrim();
+
+    unsigned char *chunk1 = CR_ChunkCacheAllocAligned(65536);
+    unsigned char *chunk2 = CR_ChunkCacheAllocAligned(65536);
+    assert_true((uintptr_t)chunk1 % 65536 == 0);
+    assert_true((uintptr_t)chunk2 % 65536 == 0);
+    memset(chunk1, 0xAB, 65536);
+    memset(chunk2, 0xAB, 65536);
+
+    CR_ChunkCacheFreeAligned(chunk1, 65536);
+    CR_ChunkCacheFreeAligned(chunk2, 65536);
+    assert_true(CR_ChunkCacheAllocAligned(65536) == chunk2);
+    assert_true(CR_ChunkCacheAllocAligned(65536) == chunk1);
+
+    CR_ChunkCacheSetLimit(65536, 1);
+    CR_ChunkCacheFreeAligned(chunk1, 65536);
+    CR_ChunkCacheFreeAligned(chunk2, 65536);
+    assert_true(CR_ChunkCacheAllocAligned(65536) == chunk1);
+    CR_ChunkCacheFreeAligned(chunk1, 65536);
+    CR_ChunkCacheSetLimit(65536, 16);
+    CR_ChunkCacheTrim();
+  }
+  testGroupEnd();
+#endif
+}
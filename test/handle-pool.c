@@ -0,0 +1,140 @@
+/** @file
+  Tests storing objects in handle pools.
+*/
+
+#include "handle-pool.h"
+
+#include <stdint.h>
+
+#include "random.h"
+#include "test.h"
+
+/** The maximal amount of objects used by the tests below. */
+#define handles_capacity 5000
+
+/** An object which knows its own handle. */
+typedef struct
+{
+  CR_Handle handle;
+  uint32_t value;
+}Object;
+
+/** Asserts that all objects in the given pool are valid and that each one
+  can be found via its own handle. */
+static void checkObjects(CR_HandlePool *pool)
+{
+  Object *objects = CR_HandlePoolObjects(pool);
+  for(size_t index = 0; index < CR_HandlePoolCount(pool); index++)
+  {
+    assert_true(CR_HandlePoolHandleAt(pool, index) == objects[index].handle);
+    assert_true(CR_HandlePoolGet(pool, objects[index].handle) ==
+                &objects[index]);
+    assert_true(objects[index].value == objects[index].handle * 3);
+  }
+}
+
+int main(void)
+{
+  testGroupStart("creating handle pools");
+  {
+    CR_Region *r = CR_RegionNew();
+    assert_error(CR_HandlePoolNew(r, 0),
+                 "unable to create handle pool for allocating zero size objects");
+
+    CR_HandlePool *pool = CR_HandlePoolNew(r, sizeof(Object));
+    assert_true(pool != NULL);
+    assert_true(CR_HandlePoolCount(pool) == 0);
+    assert_true(CR_HandlePoolGet(pool, 0) == NULL);
+    assert_true(CR_HandlePoolGet(pool, 1) == NULL);
+    assert_error(CR_HandlePoolDestroy(pool, 0),
+                 "passed invalid handle to CR_HandlePoolDestroy()");
+    assert_error(CR_HandlePoolHandleAt(pool, 0),
+                 "index 0 is out of range in handle pool with 0 objects");
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("allocating and destroying objects");
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_HandlePool *pool = CR_HandlePoolNew(r, sizeof(Object));
+
+    static CR_Handle handles[handles_capacity];
+    size_t handles_used = 0;
+    for(size_t iteration = 0; iteration < 20000; iteration++)
+    {
+      if(handles_used < handles_capacity && sRand() % 3 != 0)
+      {
+        CR_Handle handle = CR_HandlePoolAlloc(pool);
+        assert_true(handle != 0);
+
+        Object *object = CR_HandlePoolGet(pool, handle);
+        assert_true(object != NULL);
+        object->handle = handle;
+        object->value = handle * 3;
+
+        handles[handles_used] = handle;
+        handles_used++;
+      }
+      else if(handles_used > 0)
+      {
+        const size_t index = sRand() % handles_used;
+        const CR_Handle handle = handles[index];
+        CR_HandlePoolDestroy(pool, handle);
+
+        /* Stale handles are detected. */
+        assert_true(CR_HandlePoolGet(pool, handle) == NULL);
+        assert_error(CR_HandlePoolDestroy(pool, handle),
+                     "passed invalid handle to CR_HandlePoolDestroy()");
+
+        handles_used--;
+        handles[index] = handles[handles_used];
+      }
+
+      assert_true(CR_HandlePoolCount(pool) == handles_used);
+      if(iteration % 500 == 0)
+      {
+        checkObjects(pool);
+      }
+    }
+    checkObjects(pool);
+
+    for(size_t index = 0; index < handles_used; index++)
+    {
+      Object *object = CR_HandlePoolGet(pool, handles[index]);
+      assert_true(object != NULL);
+      assert_true(object->handle == handles[index]);
+    }
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("reusing slots of destroyed objects");
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_HandlePool *pool = CR_HandlePoolNew(r, 1);
+
+    CR_Handle first = CR_HandlePoolAlloc(pool);
+    CR_HandlePoolDestroy(pool, first);
+
+    /* Slots get reused with a new generation until it wraps around. */
+    CR_Handle handle = first;
+    for(size_t generation = 2; generation < 5000; generation++)
+    {
+      CR_Handle new_handle = CR_HandlePoolAlloc(pool);
+      assert_true(new_handle != handle);
+      assert_true(new_handle != 0);
+      assert_true(CR_HandlePoolGet(pool, handle) == NULL);
+      assert_true(CR_HandlePoolGet(pool, new_handle) != NULL);
+
+      CR_HandlePoolDestroy(pool, new_handle);
+      handle = new_handle;
+    }
+    assert_true(CR_HandlePoolCount(pool) == 0);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+}
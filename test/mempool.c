@@ -4,6 +4,7 @@
 
 #include "mempool.h"
 
+#include <pthread.h>
 #include <stdint.h>
 
 #include "error-handling.h"
@@ -164,6 +165,65 @@ static int allocateSelfFromMempool(void *data)
   return 0;
 }
 
+/** Implicit destructor which counts its calls. */
+static size_t implicit_destructor_calls = 0;
+static void countImplicitCalls(void *data)
+{
+  (void)data;
+  implicit_destructor_calls++;
+}
+
+/** State of visitObject(). */
+typedef struct
+{
+  size_t visited;
+  unsigned char *previous;
+  bool destroy;
+}VisitorState;
+
+/** Checks that the given object is one of the first chunks_used chunks
+  and that objects get visited in memory order. */
+static void visitObject(void *object, void *data)
+{
+  VisitorState *state = data;
+
+  bool found = false;
+  for(size_t index = 0; index < chunks_used && !found; index++)
+  {
+    found = (chunks[index].data == object);
+  }
+  assert_true(found);
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  const uintptr_t slab_mask = ~(uintptr_t)(64 * 1024 - 1);
+  if(state->previous != NULL &&
+     ((uintptr_t)state->previous & slab_mask) == ((uintptr_t)object & slab_mask))
+  {
+    assert_true(state->previous < (unsigned char *)object);
+  }
+#endif
+
+  state->previous = object;
+  state->visited++;
+  if(state->destroy)
+  {
+    CR_DestroyObject(object);
+  }
+}
+
+/** Destroys the first chunks_used objects in chunks. Used for testing
+  destroying objects in threads other than the owner of their pool. */
+static void *destroyChunks(void *data)
+{
+  (void)data;
+  for(size_t index = 0; index < chunks_used; index++)
+  {
+    CR_DestroyObject(chunks[index].data);
+  }
+
+  return NULL;
+}
+
 int main(void)
 {
   testGroupStart("creating memory pools");
@@ -206,6 +266,626 @@ int main(void)
   }
   testGroupEnd();
 
+  testGroupStart("allocating aligned objects from memory pools");
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_MempoolOptions options = { 0 };
+
+    options.alignment = 24;
+    assert_error(CR_MempoolNewWithOptions(r, 8, NULL, NULL, &options),
+                 "unable to align memory to 24 bytes");
+    options.alignment = 8192;
+    assert_error(CR_MempoolNewWithOptions(r, 8, NULL, NULL, &options),
+                 "unable to align memory to 8192 bytes");
+
+    for(size_t boundary = 1; boundary <= 4096; boundary *= 2)
+    {
+      options.alignment = boundary;
+      const size_t object_size = sRand() % 200 + 1;
+      CR_Mempool *mp =
+        CR_MempoolNewWithOptions(r, object_size, NULL, NULL, &options);
+
+      chunks_used = sRand() % 200 + 2;
+      for(size_t index = 0; index < chunks_used; index++)
+      {
+        chunks[index].data = checkedMPAlloc(mp);
+        chunks[index].size = object_size;
+        memset(chunks[index].data, sRand() % INT8_MAX, chunks[index].size);
+        assert_true((size_t)chunks[index].data % boundary == 0);
+
+        if(sRand() % 3 == 0)
+        {
+          CR_DestroyObject(chunks[index].data);
+          chunks[index].data = checkedMPAlloc(mp);
+          assert_true((size_t)chunks[index].data % boundary == 0);
+        }
+      }
+      assertNoOverlaps(chunks, chunks_used);
+    }
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("allocating objects from slabs");
+  {
+    CR_Region *r = CR_RegionNew();
+
+    const size_t object_sizes[] = { 1, 24, 100, 4000, 70000, 300000 };
+    for(size_t index = 0; index < sizeof(object_sizes)/sizeof(object_sizes[0]); index++)
+    {
+      const size_t object_size = object_sizes[index];
+      CR_Mempool *mp = CR_MempoolNew(r, object_size, NULL, NULL);
+
+      /* Interleave allocations with unrelated region allocations. */
+      chunks_used = 40;
+      for(size_t chunk = 0; chunk < chunks_used; chunk++)
+      {
+        (void)CR_RegionAlloc(r, 32);
+        chunks[chunk].data = checkedMPAlloc(mp);
+        chunks[chunk].size = object_size;
+        memset(chunks[chunk].data, 0x2F, object_size);
+      }
+      assertNoOverlaps(chunks, chunks_used);
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+      /* Objects of small pools are contiguous. */
+      if(object_size < 1000)
+      {
+        const size_t stride =
+          (size_t)chunks[1].data - (size_t)chunks[0].data;
+        assert_true(stride >= object_size);
+        for(size_t chunk = 2; chunk < chunks_used; chunk++)
+        {
+          assert_true((size_t)chunks[chunk].data -
+                      (size_t)chunks[chunk - 1].data == stride);
+        }
+      }
+#endif
+
+      for(size_t chunk = 0; chunk < chunks_used; chunk += 2)
+      {
+        CR_DestroyObject(chunks[chunk].data);
+      }
+    }
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  testGroupStart("reusing slabs of released pools");
+  {
+    CR_Region *r = CR_RegionNew();
+    void *object = checkedMPAlloc(CR_MempoolNew(r, 24, NULL, NULL));
+    CR_RegionRelease(r);
+
+    r = CR_RegionNew();
+    assert_true(checkedMPAlloc(CR_MempoolNew(r, 24, NULL, NULL)) == object);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+#endif
+
+  testGroupStart("allocating objects of almost 64 KiB");
+  {
+    CR_Region *r = CR_RegionNew();
+
+    /* These sizes enlarge slabs, which could fit two chunks each. */
+    const size_t object_sizes[] = { 64400, 64600, 64900, 65000, 65400 };
+    for(size_t index = 0; index < 2 * sizeof(object_sizes)/sizeof(object_sizes[0]); index++)
+    {
+      const size_t object_size = object_sizes[index / 2];
+      CR_Mempool *mp = index % 2 == 0 ?
+        CR_MempoolNew(r, object_size, NULL, NULL) :
+        CR_MempoolNew(r, object_size, NULL, countImplicitCalls);
+
+      chunks_used = 6;
+      for(size_t chunk = 0; chunk < chunks_used; chunk++)
+      {
+        chunks[chunk].data = checkedMPAlloc(mp);
+        chunks[chunk].size = object_size;
+        memset(chunks[chunk].data, 0x4E, object_size);
+      }
+      assertNoOverlaps(chunks, chunks_used);
+
+      for(size_t chunk = 1; chunk < chunks_used; chunk += 2)
+      {
+        CR_DestroyObject(chunks[chunk].data);
+        chunks[chunk / 2] = chunks[chunk - 1];
+      }
+      chunks_used = 3;
+
+      VisitorState state = { 0 };
+      CR_MempoolForEach(mp, visitObject, &state);
+      assert_true(state.visited == 3);
+
+      for(size_t chunk = 0; chunk < chunks_used; chunk++)
+      {
+        for(size_t byte = 0; byte < object_size; byte++)
+        {
+          assert_true(chunks[chunk].data[byte] == 0x4E);
+        }
+        CR_DestroyObject(chunks[chunk].data);
+      }
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+      assert_true(CR_MempoolTrim(mp) > 0);
+#endif
+    }
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("allocating objects without headers");
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_Mempool *small_pool = CR_MempoolNew(r, 1, NULL, NULL);
+    CR_Mempool *int_pool = CR_MempoolNew(r, sizeof(int *), NULL, NULL);
+    CR_Mempool *destructor_pool =
+      CR_MempoolNew(r, sizeof(int *), NULL, setToMinus91Implicit);
+
+    int value = 0;
+    chunks_used = 3000;
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      CR_Mempool *mp = index % 3 == 0 ? small_pool :
+        index % 3 == 1 ? int_pool : destructor_pool;
+      int **int_ptr = checkedMPAlloc(mp);
+      *int_ptr = &value;
+      CR_EnableObjectDestructor(int_ptr);
+
+      chunks[index].data = (unsigned char *)int_ptr;
+      chunks[index].size = sizeof(int *);
+    }
+    assertNoOverlaps(chunks, chunks_used);
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    /* Objects without destructors are packed without any headers. */
+    assert_true((size_t)chunks[4].data - (size_t)chunks[1].data == 8);
+    assert_true((size_t)chunks[3].data - (size_t)chunks[0].data == 8);
+#endif
+
+    for(size_t index = 0; index < chunks_used; index += 2)
+    {
+      CR_DestroyObject(chunks[index].data);
+    }
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    assert_error(CR_DestroyObject(chunks[0].data),
+                 "passed the same object to CR_DestroyObject() twice");
+    assert_error(CR_DestroyObject(chunks[4].data),
+                 "passed the same object to CR_DestroyObject() twice");
+#endif
+
+    CR_RegionRelease(r);
+    assert_true(value == -91);
+  }
+  testGroupEnd();
+
+  testGroupStart("using thread-safe memory pools through caches");
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_MempoolOptions options = { 0 };
+    options.thread_safe = true;
+
+    assert_error(CR_MempoolNewWithOptions(r, 8, setTo173Explicit, NULL, &options),
+                 "thread-safe memory pools can not have destructors");
+    assert_error(CR_MempoolNewWithOptions(r, 8, NULL, setToMinus91Implicit, &options),
+                 "thread-safe memory pools can not have destructors");
+    assert_error(CR_MempoolCacheNew(CR_MempoolNew(r, 8, NULL, NULL)),
+                 "unable to create cache for memory pool which is not thread-safe");
+
+    CR_Mempool *mp = CR_MempoolNewWithOptions(r, 24, NULL, NULL, &options);
+    CR_MempoolCache *cache1 = CR_MempoolCacheNew(mp);
+    CR_MempoolCache *cache2 = CR_MempoolCacheNew(mp);
+
+    chunks_used = 1000;
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      chunks[index].data = index % 3 == 0 ?
+        checkedMPAlloc(mp) : CR_MempoolCacheAlloc(cache1);
+      chunks[index].size = 24;
+      memset(chunks[index].data, sRand() % INT8_MAX, chunks[index].size);
+    }
+    assertNoOverlaps(chunks, chunks_used);
+
+    /* Objects can be destroyed by any cache. */
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      if(index % 2 == 0)
+      {
+        CR_MempoolCacheDestroyObject(cache2, chunks[index].data);
+      }
+      else
+      {
+        CR_DestroyObject(chunks[index].data);
+      }
+    }
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    assert_error(CR_DestroyObject(chunks[1].data),
+                 "passed the same object to CR_DestroyObject() twice");
+#endif
+
+    /* Reuse objects passed between caches through the depot. */
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      chunks[index].data = CR_MempoolCacheAlloc(index % 2 == 0 ? cache1 : cache2);
+      memset(chunks[index].data, sRand() % INT8_MAX, chunks[index].size);
+    }
+    assertNoOverlaps(chunks, chunks_used);
+
+    for(size_t index = 0; index < chunks_used / 2; index++)
+    {
+      CR_MempoolCacheDestroyObject(cache1, chunks[index].data);
+    }
+    CR_MempoolCacheFlush(cache1);
+    CR_MempoolCacheFlush(cache2);
+    for(size_t index = 0; index < chunks_used / 2; index++)
+    {
+      chunks[index].data = checkedMPAlloc(mp);
+    }
+    assertNoOverlaps(chunks, chunks_used);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("allocating and destroying objects in batches");
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_Mempool *plain_pool = CR_MempoolNew(r, 32, NULL, NULL);
+    CR_Mempool *destructor_pool =
+      CR_MempoolNew(r, sizeof(int *), setTo173Explicit, NULL);
+
+    static void *objects[chunks_capacity];
+    int value = 0;
+    chunks_used = 0;
+    while(chunks_used < 4000)
+    {
+      const size_t count = sRand() % 257;
+      CR_Mempool *mp = sRand() % 2 == 0 ? plain_pool : destructor_pool;
+      CR_MempoolAllocBatch(mp, &objects[chunks_used], count);
+
+      for(size_t index = chunks_used; index < chunks_used + count; index++)
+      {
+        int **int_ptr = objects[index];
+        *int_ptr = &value;
+        CR_EnableObjectDestructor(int_ptr);
+
+        chunks[index].data = objects[index];
+        chunks[index].size = sizeof(int *);
+      }
+      chunks_used += count;
+    }
+    assertNoOverlaps(chunks, chunks_used);
+
+    /* Destroy objects of both pools in mixed batches. */
+    size_t index = 0;
+    while(index < chunks_used)
+    {
+      const size_t remaining = chunks_used - index;
+      const size_t count = sRand() % 257 % remaining + 1;
+
+      CR_DestroyObjects(&objects[index], count);
+      index += count;
+    }
+    assert_true(value == 173);
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    assert_error(CR_DestroyObjects(&objects[10], 3),
+                 "passed the same object to CR_DestroyObject() twice");
+#endif
+
+    /* Passing the same object twice in one batch. */
+    CR_MempoolAllocBatch(plain_pool, objects, 3);
+    CR_MempoolAllocBatch(destructor_pool, &objects[3], 3);
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    objects[6] = objects[1];
+    assert_error(CR_DestroyObjects(objects, 7),
+                 "passed the same object to CR_DestroyObject() twice");
+#endif
+
+    /* Reuse part of the released objects in batches and mix them with
+       single objects. */
+    CR_Mempool *implicit_pool =
+      CR_MempoolNew(r, 24, NULL, countImplicitCalls);
+    CR_MempoolAllocBatch(implicit_pool, objects, 300);
+    CR_DestroyObjects(&objects[100], 200);
+    objects[100] = checkedMPAlloc(implicit_pool);
+    CR_MempoolAllocBatch(implicit_pool, &objects[101], 150);
+    CR_MempoolAllocBatch(implicit_pool, &objects[251], 100);
+
+    chunks_used = 351;
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      CR_EnableObjectDestructor(objects[index]);
+      chunks[index].data = objects[index];
+      chunks[index].size = 24;
+    }
+    assertNoOverlaps(chunks, chunks_used);
+
+    VisitorState state = { 0 };
+    CR_MempoolForEach(implicit_pool, visitObject, &state);
+    assert_true(state.visited == chunks_used);
+
+    implicit_destructor_calls = 0;
+    CR_RegionRelease(r);
+    assert_true(implicit_destructor_calls == chunks_used);
+  }
+  testGroupEnd();
+
+  testGroupStart("clearing memory pools");
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_Mempool *plain_pool = CR_MempoolNew(r, 24, NULL, NULL);
+    CR_Mempool *destructor_pool =
+      CR_MempoolNew(r, 24, NULL, countImplicitCalls);
+    CR_MempoolClear(plain_pool);
+    CR_MempoolClear(destructor_pool);
+
+    for(size_t round = 0; round < 5; round++)
+    {
+      implicit_destructor_calls = 0;
+      size_t enabled_destructors = 0;
+      chunks_used = 4000;
+      for(size_t index = 0; index < chunks_used; index++)
+      {
+        CR_Mempool *mp = index % 2 == 0 ? plain_pool : destructor_pool;
+        chunks[index].data = checkedMPAlloc(mp);
+        chunks[index].size = 24;
+        memset(chunks[index].data, sRand() % INT8_MAX, chunks[index].size);
+
+        if(mp == destructor_pool && index % 3 != 0 && sRand() % 2 == 0)
+        {
+          CR_EnableObjectDestructor(chunks[index].data);
+          enabled_destructors++;
+        }
+      }
+      assertNoOverlaps(chunks, chunks_used);
+
+      for(size_t index = 0; index < chunks_used; index += 3)
+      {
+        CR_DestroyObject(chunks[index].data);
+      }
+
+      CR_MempoolClear(plain_pool);
+      CR_MempoolClear(destructor_pool);
+      assert_true(implicit_destructor_calls == enabled_destructors);
+    }
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    /* The memory of cleared objects gets reused. */
+    unsigned char *old_object = chunks[0].data;
+    assert_error(CR_DestroyObject(old_object),
+                 "passed the same object to CR_DestroyObject() twice");
+    bool reused = false;
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      reused = reused || (checkedMPAlloc(plain_pool) == old_object);
+    }
+    assert_true(reused);
+#endif
+
+    implicit_destructor_calls = 0;
+    CR_EnableObjectDestructor(checkedMPAlloc(destructor_pool));
+    CR_RegionRelease(r);
+    assert_true(implicit_destructor_calls == 1);
+  }
+  testGroupEnd();
+
+  testGroupStart("trimming memory pools");
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_Mempool *plain_pool = CR_MempoolNew(r, 200, NULL, NULL);
+    CR_Mempool *destructor_pool = CR_MempoolNew(r, 200, setTo173Explicit, NULL);
+    assert_true(CR_MempoolTrim(plain_pool) == 0);
+
+    for(size_t round = 0; round < 3; round++)
+    {
+      CR_Mempool *mp = round % 2 == 0 ? plain_pool : destructor_pool;
+
+      chunks_used = 5000;
+      for(size_t index = 0; index < chunks_used; index++)
+      {
+        chunks[index].data = checkedMPAlloc(mp);
+        chunks[index].size = 200;
+      }
+
+      /* Keep every 1000th object alive and fill it with a pattern. */
+      for(size_t index = 0; index < chunks_used; index++)
+      {
+        if(index % 1000 == 0)
+        {
+          memset(chunks[index].data, (int)(index / 1000 + 1), 200);
+        }
+        else
+        {
+          CR_DestroyObject(chunks[index].data);
+        }
+      }
+
+      const size_t bytes_released = CR_MempoolTrim(mp);
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+      assert_true(bytes_released == 0);
+#else
+      assert_true(bytes_released > 0);
+      assert_true(bytes_released % (64 * 1024) == 0);
+#endif
+      assert_true(CR_MempoolTrim(mp) == 0);
+
+      for(size_t index = 0; index < chunks_used; index += 1000)
+      {
+        for(size_t byte = 0; byte < 200; byte++)
+        {
+          assert_true(chunks[index].data[byte] == index / 1000 + 1);
+        }
+        chunks[index / 1000] = chunks[index];
+      }
+
+      /* Allocate from the remaining slabs and new ones. */
+      for(chunks_used = 5; chunks_used < 5000; chunks_used++)
+      {
+        chunks[chunks_used].data = checkedMPAlloc(mp);
+        chunks[chunks_used].size = 200;
+        memset(chunks[chunks_used].data, 0, 200);
+      }
+      assertNoOverlaps(chunks, chunks_used);
+      CR_MempoolClear(mp);
+    }
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    /* Spare slabs left by CR_MempoolClear() get released too. */
+    assert_true(CR_MempoolTrim(destructor_pool) > 0);
+#endif
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("reserving memory in pools");
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_Mempool *mp = CR_MempoolNew(r, 32, NULL, NULL);
+
+    CR_MempoolReserve(mp, 0, true);
+    assert_true(CR_MempoolTrim(mp) == 0);
+
+    CR_MempoolReserve(mp, 10000, true);
+    const size_t bytes_reserved = CR_MempoolTrim(mp);
+#ifdef CREGION_ALWAYS_FRESH_MALLOC
+    assert_true(bytes_reserved == 0);
+#else
+    assert_true(bytes_reserved >= 10000 * 32);
+    assert_true(bytes_reserved < 10000 * 32 + 64 * 1024);
+#endif
+
+    CR_MempoolReserve(mp, 10000, false);
+    CR_MempoolReserve(mp, 5000, true);
+    chunks_used = 5000;
+    for(size_t index = 0; index < 10000; index++)
+    {
+      chunks[index % chunks_used].data = checkedMPAlloc(mp);
+      chunks[index % chunks_used].size = 32;
+    }
+    assertNoOverlaps(chunks, chunks_used);
+
+    /* All reserved slabs are in use now. */
+    assert_true(CR_MempoolTrim(mp) == 0);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("iterating over objects in memory pools");
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_Mempool *pools[] =
+    {
+      CR_MempoolNew(r, 16, NULL, NULL),
+      CR_MempoolNew(r, 16, NULL, setToMinus91Implicit),
+    };
+
+    for(size_t pool_index = 0; pool_index < 2; pool_index++)
+    {
+      CR_Mempool *mp = pools[pool_index];
+      VisitorState state = { 0 };
+      CR_MempoolForEach(mp, visitObject, &state);
+      assert_true(state.visited == 0);
+
+      chunks_used = 5000;
+      for(size_t index = 0; index < chunks_used; index++)
+      {
+        chunks[index].data = checkedMPAlloc(mp);
+        chunks[index].size = 16;
+      }
+
+      /* Destroy some objects and move them to the end of the array. */
+      size_t live_objects = chunks_used;
+      for(size_t index = 0; index < live_objects;)
+      {
+        if(sRand() % 3 == 0)
+        {
+          CR_DestroyObject(chunks[index].data);
+          live_objects--;
+
+          AllocatedChunk tmp = chunks[index];
+          chunks[index] = chunks[live_objects];
+          chunks[live_objects] = tmp;
+        }
+        else
+        {
+          index++;
+        }
+      }
+      chunks_used = live_objects;
+
+      CR_MempoolForEach(mp, visitObject, &state);
+      assert_true(state.visited == live_objects);
+
+      state.visited = 0;
+      state.previous = NULL;
+      state.destroy = true;
+      CR_MempoolForEach(mp, visitObject, &state);
+      assert_true(state.visited == live_objects);
+
+      state.visited = 0;
+      CR_MempoolForEach(mp, visitObject, &state);
+      assert_true(state.visited == 0);
+    }
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("destroying objects from other threads");
+  {
+    CR_Region *r = CR_RegionNew();
+    CR_MempoolOptions options = { 0 };
+    options.remote_destroy = true;
+
+    assert_error(CR_MempoolNewWithOptions(r, 8, NULL, setToMinus91Implicit, &options),
+                 "thread-safe memory pools can not have destructors");
+    options.thread_safe = true;
+    assert_error(CR_MempoolNewWithOptions(r, 8, NULL, NULL, &options),
+                 "thread-safe memory pools can not have the remote_destroy option");
+    options.thread_safe = false;
+
+    CR_Mempool *mp = CR_MempoolNewWithOptions(r, 40, NULL, NULL, &options);
+    chunks_used = 500;
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      chunks[index].data = checkedMPAlloc(mp);
+      chunks[index].size = 40;
+      memset(chunks[index].data, sRand() % INT8_MAX, chunks[index].size);
+    }
+    assertNoOverlaps(chunks, chunks_used);
+
+    pthread_t thread;
+    assert_true(pthread_create(&thread, NULL, destroyChunks, NULL) == 0);
+    assert_true(pthread_join(thread, NULL) == 0);
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    /* The owner reuses all objects destroyed by the other thread. */
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      void *object = checkedMPAlloc(mp);
+      bool found = false;
+      for(size_t other = 0; other < chunks_used && !found; other++)
+      {
+        found = (chunks[other].data == object);
+      }
+      assert_true(found);
+    }
+
+    /* Objects destroyed by the owner go directly back to the pool. */
+    void *object = checkedMPAlloc(mp);
+    CR_DestroyObject(object);
+    assert_true(checkedMPAlloc(mp) == object);
+#endif
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
   testGroupStart("destructor calling");
   for(size_t iterations = 0; iterations < 5000; iterations++)
   {
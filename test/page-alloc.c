@@ -0,0 +1,77 @@
+/** @file
+  Tests the allocation of memory pages.
+*/
+
+#include "page-alloc.h"
+
+#include <stdint.h>
+
+#include "test.h"
+
+int main(void)
+{
+  testGroupStart("allocating and freeing pages");
+  {
+    assert_error(CR_PageAlloc(0), "unable to allocate 0 bytes");
+
+    const size_t sizes[] = { 1, 100, 4096, 4097, 65536, 1048576, 3000000 };
+    for(size_t index = 0; index < sizeof(sizes)/sizeof(sizes[0]); index++)
+    {
+      unsigned char *pages = CR_PageAlloc(sizes[index]);
+      assert_true(pages != NULL);
+      assert_true((uintptr_t)pages % 8 == 0);
+
+      memset(pages, 0xC7, sizes[index]);
+      assert_true(pages[sizes[index] - 1] == 0xC7);
+      CR_PageFree(pages, sizes[index]);
+    }
+  }
+  testGroupEnd();
+
+  testGroupStart("allocating aligned pages");
+  {
+    assert_error(CR_PageAllocAligned(0, 64), "unable to allocate 0 bytes");
+    assert_error(CR_PageAllocAligned(64, 0), "unable to align memory to 0 bytes");
+    assert_error(CR_PageAllocAligned(64, 48), "unable to align memory to 48 bytes");
+
+    for(size_t boundary = 8; boundary <= 1048576; boundary *= 4)
+    {
+      const size_t size = boundary * 3 + 5;
+      unsigned char *pages = CR_PageAllocAligned(size, boundary);
+      assert_true(pages != NULL);
+      assert_true((uintptr_t)pages % boundary == 0);
+
+      memset(pages, 0x3D, size);
+      CR_PageFree(pages, size);
+    }
+  }
+  testGroupEnd();
+
+  testGroupStart("reallocating pages");
+  {
+    size_t size = 100;
+    unsigned char *pages = CR_PageAlloc(size);
+    memset(pages, 0x5A, size);
+    assert_error(CR_PageRealloc(pages, size, 0), "unable to allocate 0 bytes");
+
+    const size_t sizes[] = { 4096, 4097, 1048576, 5000000, 6000, 3000000, 10 };
+    for(size_t index = 0; index < sizeof(sizes)/sizeof(sizes[0]); index++)
+    {
+      const size_t new_size = sizes[index];
+      pages = CR_PageRealloc(pages, size, new_size);
+      assert_true(pages != NULL);
+      assert_true((uintptr_t)pages % 8 == 0);
+
+      const size_t preserved_size = size < new_size ? size : new_size;
+      for(size_t byte = 0; byte < preserved_size; byte++)
+      {
+        assert_true(pages[byte] == 0x5A);
+      }
+
+      memset(pages, 0x5A, new_size);
+      size = new_size;
+    }
+    CR_PageFree(pages, size);
+  }
+  testGroupEnd();
+}
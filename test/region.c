@@ -41,6 +41,22 @@ static void *checkedAlloc(CR_Region *r, size_t size)
   return data;
 }
 
+/** Wrapper around CR_RegionAllocAligned(), which checks the returned
+  memory. */
+static void *checkedAllocAligned(CR_Region *r, size_t size, size_t boundary)
+{
+  void *data = CR_RegionAllocAligned(r, size, boundary);
+  assert_true(data != NULL);
+
+  if((size_t)data % boundary != 0)
+  {
+    CR_ExitFailure("region failed to align memory to %zu bytes: %p",
+                   boundary, data);
+  }
+
+  return data;
+}
+
 /** Wrapper around CR_RegionAlloc(), which checks the returned memory. */
 static void *checkedAllocUnaligned(CR_Region *r, size_t size)
 {
@@ -96,6 +112,14 @@ static void setToTrue(void *data)
   bool *value = data;
   *value = true;
 }
+static size_t callback_counter = 0;
+static void checkCounterMatches(void *data)
+{
+  const size_t *index = data;
+  assert_abort(callback_counter > 0);
+  callback_counter--;
+  assert_abort(*index == callback_counter);
+}
 static int atexit_test_number = 0;
 static void lastCallback(void *data)
 {
@@ -279,11 +303,64 @@ int main(void)
   }
   testGroupEnd();
 
+  testGroupStart("calling many callbacks");
+  {
+    static size_t indices[1000];
+    for(size_t index = 0; index < 1000; index++)
+    {
+      indices[index] = index;
+    }
+
+    CR_Region *r = checkedRegion();
+    for(size_t index = 0; index < 1000; index++)
+    {
+      CR_RegionAttach(r, checkCounterMatches, &indices[index]);
+    }
+
+    callback_counter = 1000;
+    CR_RegionRelease(r);
+    assert_true(callback_counter == 0);
+
+    /* Roll back to savepoints inside and between callback blocks. */
+    r = checkedRegion();
+    for(size_t index = 0; index < 300; index++)
+    {
+      CR_RegionAttach(r, checkCounterMatches, &indices[index]);
+    }
+
+    CR_RegionSavepoint *mark = CR_RegionMark(r);
+    for(size_t counter = 0; counter < 5; counter++)
+    {
+      const size_t attached = sRand() % 700;
+      for(size_t index = 300; index < 300 + attached; index++)
+      {
+        CR_RegionAttach(r, checkCounterMatches, &indices[index]);
+      }
+
+      callback_counter = 300 + attached;
+      CR_RegionRollback(r, mark);
+      assert_true(callback_counter == 300);
+    }
+
+    CR_RegionReset(r);
+    assert_true(callback_counter == 0);
+    CR_RegionAttach(r, checkCounterMatches, &indices[0]);
+
+    callback_counter = 1;
+    CR_RegionRelease(r);
+    assert_true(callback_counter == 0);
+  }
+  testGroupEnd();
+
 #ifndef CREGION_ALWAYS_FRESH_MALLOC
   testGroupStart("padding of memory 1");
   {
     CR_Region *r = CR_RegionNew();
 
+    /* Skip the remaining space in the first chunk, which is shared with
+       the region itself. All following allocations fit into one chunk. */
+    (void)checkedAlloc(r, 512);
+
     void *data[] =
     {
       checkedAlloc(r, 1),
@@ -327,6 +404,10 @@ int main(void)
     chunks_used = 40;
     CR_Region *r = CR_RegionNew();
 
+    /* Skip the remaining space in the first chunk, which is shared with
+       the region itself. All following allocations fit into one chunk. */
+    (void)checkedAlloc(r, 512);
+
     for(size_t index = 0; index < chunks_used; index++)
     {
       chunks[index].size = (index % 8) + 1;
@@ -359,6 +440,556 @@ int main(void)
                   "randomly aligned allocations from random regions",
                   checkedAllocRandom);
 
+  testGroupStart("inline allocations");
+  {
+    CR_Region *r = checkedRegion();
+
+    assert_error(CR_RegionAllocInline(r, 0), "unable to allocate 0 bytes");
+    assert_error(CR_RegionAllocUnalignedInline(r, 0), "unable to allocate 0 bytes");
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    assert_error(CR_RegionAllocInline(r, SIZE_MAX), "overflow calculating object size");
+    assert_error(CR_RegionAllocInline(r, SIZE_MAX - 6), "overflow calculating object size");
+    assert_error(CR_RegionAllocUnalignedInline(r, SIZE_MAX), "overflow calculating object size");
+#endif
+
+    chunks_used = 5000;
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      chunks[index].size = sRand() % 2 == 0 ?
+        (size_t)(sRand() % 64 + 1) : (size_t)(sRand() % 3000 + 1);
+
+      switch(sRand() % 3)
+      {
+        case 0:
+          chunks[index].data = CR_RegionAllocInline(r, chunks[index].size);
+          assert_true((size_t)chunks[index].data % 8 == 0);
+          break;
+        case 1:
+          chunks[index].data =
+            CR_RegionAllocUnalignedInline(r, chunks[index].size);
+          break;
+        default:
+          chunks[index].data = checkedAllocRandom(r, chunks[index].size);
+      }
+      memset(chunks[index].data, 0x3C, chunks[index].size);
+    }
+    assertNoOverlaps(chunks, chunks_used);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("allocating memory with custom alignment");
+  {
+    CR_Region *r = checkedRegion();
+
+    assert_error(CR_RegionAllocAligned(r, 8, 0), "unable to align memory to 0 bytes");
+    assert_error(CR_RegionAllocAligned(r, 8, 3), "unable to align memory to 3 bytes");
+    assert_error(CR_RegionAllocAligned(r, 8, 48), "unable to align memory to 48 bytes");
+    assert_error(CR_RegionAllocAligned(r, 8, 8192), "unable to align memory to 8192 bytes");
+    assert_error(CR_RegionAllocAligned(r, 0, 64), "unable to allocate 0 bytes");
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    assert_error(CR_RegionAllocAligned(r, SIZE_MAX, 64), "overflow calculating object size");
+#endif
+
+    chunks_used = 3000;
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      const size_t boundary = (size_t)1 << (sRand() % 13);
+      chunks[index].size = sRand() % 2 == 0 ?
+        (size_t)(sRand() % 64 + 1) : (size_t)(sRand() % 6000 + 1);
+      chunks[index].data = checkedAllocAligned(r, chunks[index].size, boundary);
+      memset(chunks[index].data, 0x5A, chunks[index].size);
+
+      /* Interleave allocations with default alignment. */
+      if(sRand() % 4 == 0)
+      {
+        index++;
+        chunks[index].size = sRand() % 100 + 1;
+        chunks[index].data = checkedAllocRandom(r, chunks[index].size);
+      }
+    }
+    assertNoOverlaps(chunks, chunks_used);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  testGroupStart("padding of memory with custom alignment");
+  {
+    CR_Region *r = checkedRegion();
+    (void)checkedAlloc(r, 512);
+
+    unsigned char *data = checkedAllocAligned(r, 1, 64);
+    assert_true(checkedAllocAligned(r, 64, 64) == &data[64]);
+    assert_true(checkedAllocAligned(r, 3, 16) == &data[128]);
+    assert_true(checkedAlloc(r, 1) == &data[136]);
+
+    const size_t offset = (size_t)data % 128 == 0 ? 256 : 192;
+    assert_true(checkedAllocAligned(r, 100, 128) == &data[offset]);
+    assert_true(checkedAlloc(r, 1) == &data[offset + 104]);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+#endif
+
+  testGroupStart("creating regions with options");
+  {
+    CR_RegionOptions options = { 0 };
+    options.aligned_percent = 101;
+    assert_error(CR_RegionNewWithOptions(&options),
+                 "aligned part of region exceeds 100 percent: 101");
+
+    options.aligned_percent = 0;
+    options.initial_capacity = 64;
+    assert_error(CR_RegionNewWithOptions(&options),
+                 "initial region capacity too small: 64 bytes");
+    options.initial_capacity = SIZE_MAX;
+    options.aligned_percent = 80;
+    assert_error(CR_RegionNewWithOptions(&options),
+                 "overflow calculating object size");
+
+    options.initial_capacity = 8192;
+    options.max_chunk_size = 4096;
+    assert_error(CR_RegionNewWithOptions(&options),
+                 "maximum chunk size smaller than initial capacity: 4096 bytes");
+    options.max_chunk_size = 0;
+    options.growth_factor = SIZE_MAX;
+    assert_error(CR_RegionNewWithOptions(&options),
+                 "overflow calculating object size");
+
+    /* A limited chunk size clamps the growth instead. */
+    options.max_chunk_size = 16384;
+    CR_Region *clamped = CR_RegionNewWithOptions(&options);
+    assert_true(clamped != NULL);
+    for(size_t index = 0; index < 100; index++)
+    {
+      memset(checkedAlloc(clamped, 3000), 0x5A, 3000);
+    }
+    CR_RegionRelease(clamped);
+
+    for(size_t counter = 0; counter < 30; counter++)
+    {
+      options.initial_capacity = (size_t)(sRand() % 70000) + 1024;
+      options.aligned_percent = (size_t)(sRand() % 50) + 51;
+      options.growth_factor = (size_t)(sRand() % 4);
+      options.max_chunk_size = sRand() % 2 == 0 ? 0 :
+        options.initial_capacity + (size_t)(sRand() % 100000);
+      options.large_allocation_size = sRand() % 2 == 0 ? 0 :
+        (size_t)(sRand() % 4000) + 1;
+
+      CR_Region *r = CR_RegionNewWithOptions(&options);
+      assert_true(r != NULL);
+
+      chunks_used = sRand() % 2500 + 20;
+      const int value = sRand() % INT8_MAX;
+      for(size_t index = 0; index < chunks_used; index++)
+      {
+        chunks[index].size = sRand() % 3000 + 1;
+        chunks[index].data = checkedAllocRandom(r, chunks[index].size);
+        memset(chunks[index].data, value, chunks[index].size);
+      }
+      assertNoOverlaps(chunks, chunks_used);
+
+      CR_RegionReset(r);
+      CR_RegionRelease(r);
+    }
+  }
+  testGroupEnd();
+
+  testGroupStart("freeing large allocations");
+  {
+    CR_Region *r = checkedRegion();
+    CR_RegionFreeLarge(r, checkedAlloc(r, 300000));
+    CR_RegionFreeLarge(r, checkedAllocUnaligned(r, 262144));
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    memset(checkedAlloc(r, 100), 0, 100);
+    void *small_data = checkedAlloc(r, 100);
+    void *large_data = checkedAlloc(r, 300000);
+    CR_Region *other_region = checkedRegion();
+    assert_error(CR_RegionFreeLarge(r, small_data),
+                 "passed invalid pointer to CR_RegionFreeLarge()");
+    assert_error(CR_RegionFreeLarge(other_region, large_data),
+                 "passed invalid pointer to CR_RegionFreeLarge()");
+    CR_RegionRelease(other_region);
+    CR_RegionFreeLarge(r, large_data);
+#endif
+
+    CR_RegionOptions options = { 0 };
+    options.large_allocation_size = 4096;
+    CR_Region *r2 = CR_RegionNewWithOptions(&options);
+    assert_true(r2 != NULL);
+
+    chunks_used = 300;
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      chunks[index].data = NULL;
+    }
+
+    for(size_t counter = 0; counter < 3; counter++)
+    {
+      for(size_t index = 0; index < chunks_used; index++)
+      {
+        if(chunks[index].data != NULL)
+        {
+          continue;
+        }
+
+        chunks[index].size = sRand() % 10000 + 1;
+        switch(sRand() % 4)
+        {
+          case 0:
+            chunks[index].data =
+              checkedAllocAligned(r2, chunks[index].size, 4096);
+            break;
+          case 1:
+            chunks[index].data =
+              CR_RegionAllocInline(r2, chunks[index].size);
+            break;
+          default:
+            chunks[index].data = checkedAllocRandom(r2, chunks[index].size);
+        }
+        memset(chunks[index].data, 0x5A, chunks[index].size);
+      }
+      assertNoOverlaps(chunks, chunks_used);
+
+      /* Free about half of all large allocations. */
+      for(size_t index = 0; index < chunks_used; index++)
+      {
+        if(chunks[index].size >= 4096 && sRand() % 2 == 0)
+        {
+          CR_RegionFreeLarge(r2, chunks[index].data);
+          chunks[index].data = NULL;
+        }
+      }
+    }
+
+    /* Large allocations older than a savepoint survive rolling back. */
+    CR_RegionSavepoint *mark = CR_RegionMark(r2);
+    for(size_t counter = 0; counter < 10; counter++)
+    {
+      void *data = checkedAlloc(r2, 5000);
+      if(counter % 3 == 0)
+      {
+        CR_RegionFreeLarge(r2, data);
+      }
+    }
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      if(chunks[index].size >= 4096 && chunks[index].data != NULL)
+      {
+        CR_RegionFreeLarge(r2, chunks[index].data);
+        chunks[index].data = NULL;
+        break;
+      }
+    }
+    CR_RegionRollback(r2, mark);
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      if(chunks[index].size >= 4096 && chunks[index].data != NULL)
+      {
+        CR_RegionFreeLarge(r2, chunks[index].data);
+        chunks[index].data = NULL;
+        break;
+      }
+    }
+    for(size_t index = 0; index < chunks_used; index++)
+    {
+      if(chunks[index].data != NULL)
+      {
+        memset(chunks[index].data, 0x7E, chunks[index].size);
+      }
+    }
+    (void)checkedAllocUnaligned(r2, 70000);
+
+    CR_RegionReset(r2);
+    (void)checkedAllocUnaligned(r2, 70000);
+
+    CR_RegionRelease(r2);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("collecting region statistics");
+  {
+    CR_Region *r = checkedRegion();
+    CR_RegionStats stats;
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.bytes_requested == 0);
+    assert_true(stats.bytes_used == 0);
+    assert_true(stats.bytes_wasted == 0);
+    assert_true(stats.chunk_count == 1);
+    assert_true(stats.chunk_bytes == 1024);
+    assert_true(stats.chunk_counts[0] == 1);
+    assert_true(stats.large_allocation_count == 0);
+    assert_true(stats.large_allocation_bytes == 0);
+    assert_true(stats.callback_count == 0);
+    assert_true(stats.high_water_mark == 1024);
+
+    bool value = false;
+    (void)checkedAlloc(r, 3);
+    (void)CR_RegionAllocInline(r, 5);
+    (void)checkedAllocUnaligned(r, 7);
+    (void)CR_RegionAllocUnalignedInline(r, 1);
+    (void)checkedAllocAligned(r, 10, 64);
+    CR_RegionAttach(r, setToTrue, &value);
+
+    CR_RegionStats before_mark;
+    CR_RegionGetStats(r, &before_mark);
+    assert_true(before_mark.bytes_requested == 26);
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    assert_true(before_mark.callback_count == 1);
+    assert_true(before_mark.bytes_used >= 40);
+    assert_true(before_mark.bytes_used < 40 + 64);
+    assert_true(before_mark.bytes_wasted == 0);
+    assert_true(before_mark.chunk_count == 1);
+#endif
+
+    CR_RegionSavepoint *mark = CR_RegionMark(r);
+    CR_RegionGetStats(r, &before_mark);
+    for(size_t counter = 0; counter < 3; counter++)
+    {
+      (void)checkedAlloc(r, 5000);
+    }
+    (void)checkedAlloc(r, 1000);
+    CR_RegionFreeLarge(r, checkedAlloc(r, 400000));
+    (void)checkedAllocUnaligned(r, 300000);
+    CR_RegionAttach(r, setToTrue, &value);
+
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.bytes_requested == before_mark.bytes_requested + 16000);
+    assert_true(stats.large_allocation_count == 1);
+    assert_true(stats.large_allocation_bytes == 300000);
+    assert_true(stats.high_water_mark >= 400000);
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    assert_true(stats.callback_count == 2);
+    assert_true(stats.bytes_used >= before_mark.bytes_used + 16000);
+    assert_true(stats.bytes_wasted > 0);
+    assert_true(stats.chunk_count == 5);
+    assert_true(stats.chunk_counts[0] == 1);
+    assert_true(stats.chunk_counts[1] == 1);
+    assert_true(stats.chunk_counts[3] == 3);
+    assert_true(stats.chunk_bytes > 1024 + 2048 + 3 * 5000);
+#endif
+
+    CR_RegionRollback(r, mark);
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.bytes_requested == before_mark.bytes_requested);
+    assert_true(stats.bytes_used == before_mark.bytes_used);
+    assert_true(stats.bytes_wasted == before_mark.bytes_wasted);
+    assert_true(stats.bytes_free == before_mark.bytes_free);
+    assert_true(stats.chunk_count == before_mark.chunk_count);
+    assert_true(stats.chunk_bytes == before_mark.chunk_bytes);
+    assert_true(stats.large_allocation_count == 0);
+    assert_true(stats.callback_count == before_mark.callback_count);
+    assert_true(stats.high_water_mark >= 400000);
+
+    CR_RegionReset(r);
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.bytes_requested == 0);
+    assert_true(stats.bytes_used == 0);
+    assert_true(stats.bytes_wasted == 0);
+    assert_true(stats.callback_count == 0);
+    assert_true(value == true);
+
+    /* Chunks kept by resets must not count as used. */
+    for(size_t counter = 0; counter < 50; counter++)
+    {
+      (void)checkedAlloc(r, 3000);
+      (void)checkedAllocUnaligned(r, 2000);
+    }
+    CR_RegionReset(r);
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.bytes_requested == 0);
+    assert_true(stats.bytes_used == 0);
+
+    (void)checkedAlloc(r, 100);
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.bytes_requested == 100);
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+    assert_true(stats.bytes_used == 104);
+#endif
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("rolling back to savepoints");
+  {
+    CR_Region *r = checkedRegion();
+
+    bool value = false;
+    CR_RegionAttach(r, setToTrue, &value);
+
+    CR_RegionSavepoint *mark = CR_RegionMark(r);
+    assert_true(mark != NULL);
+    CR_RegionRollback(r, mark);
+
+    int number = 0;
+    CR_RegionAttach(r, checkValueIs5, &number);
+    CR_RegionAttach(r, checkValueIs27, &number);
+    CR_RegionAttach(r, checkValueIsMinus3, &number);
+
+    number = -3;
+    CR_RegionRollback(r, mark);
+    assert_true(number == -1234);
+    assert_true(value == false);
+
+    for(size_t counter = 0; counter < 10; counter++)
+    {
+      chunks_used = sRand() % 1000 + 20;
+      const int fill_value = sRand() % INT8_MAX;
+
+      for(size_t index = 0; index < chunks_used; index++)
+      {
+        if(index == chunks_used/2)
+        {
+          CR_RegionSavepoint *nested_mark = CR_RegionMark(r);
+          (void)checkedAllocRandom(r, sRand() % 5000 + 1);
+          CR_RegionRollback(r, nested_mark);
+        }
+
+        chunks[index].size = sRand() % 2300 + 1;
+        chunks[index].data = checkedAllocRandom(r, chunks[index].size);
+        memset(chunks[index].data, fill_value, chunks[index].size);
+      }
+
+      assertNoOverlaps(chunks, chunks_used);
+      CR_RegionRollback(r, mark);
+    }
+
+    CR_RegionRelease(r);
+    assert_true(value == true);
+  }
+  testGroupEnd();
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  testGroupStart("reusing memory after rolling back");
+  {
+    CR_Region *r = checkedRegion();
+    (void)checkedAlloc(r, 100);
+
+    CR_RegionSavepoint *mark = CR_RegionMark(r);
+    void *aligned = checkedAlloc(r, 20);
+    void *unaligned = checkedAllocUnaligned(r, 3);
+    for(size_t index = 0; index < 100; index++)
+    {
+      (void)checkedAllocRandom(r, 1000);
+    }
+
+    CR_RegionRollback(r, mark);
+    assert_true(checkedAllocUnaligned(r, 3) == unaligned);
+    assert_true(checkedAlloc(r, 20) == aligned);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+#endif
+
+  testGroupStart("resetting a region");
+  {
+    CR_Region *r = checkedRegion();
+
+    bool value = false;
+    CR_RegionAttach(r, setToTrue, &value);
+    CR_RegionReset(r);
+    assert_true(value == true);
+
+    value = false;
+    CR_RegionReset(r);
+    assert_true(value == false);
+
+    for(size_t counter = 0; counter < 10; counter++)
+    {
+      const size_t limit = (size_t)(sRand() % 100000);
+      CR_RegionSetRetainLimit(r, sRand() % 2 == 0 ? SIZE_MAX : limit);
+      chunks_used = sRand() % 2500 + 20;
+      const int fill_value = sRand() % INT8_MAX;
+
+      for(size_t index = 0; index < chunks_used; index++)
+      {
+        chunks[index].size = sRand() % 2300 + 1;
+        chunks[index].data = checkedAllocRandom(r, chunks[index].size);
+        memset(chunks[index].data, fill_value, chunks[index].size);
+      }
+
+      assertNoOverlaps(chunks, chunks_used);
+      CR_RegionReset(r);
+    }
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  testGroupStart("reusing chunks after resetting a region");
+  {
+    CR_Region *r = checkedRegion();
+    void *first_allocation = checkedAlloc(r, 8);
+
+    /* Repeat the same allocations until the region stops growing. */
+    void *previous_allocations[100] = { NULL };
+    for(size_t counter = 0; counter < 5; counter++)
+    {
+      CR_RegionReset(r);
+
+      bool allocations_match = true;
+      for(size_t index = 0; index < 100; index++)
+      {
+        void *data = checkedAlloc(r, 1000);
+        allocations_match &= (data == previous_allocations[index]);
+        previous_allocations[index] = data;
+      }
+      assert_true(allocations_match == (counter > 2));
+    }
+
+    /* Shrink the region back to its first chunk. */
+    CR_RegionSetRetainLimit(r, 0);
+    CR_RegionReset(r);
+    assert_true(checkedAlloc(r, 8) == first_allocation);
+
+    /* Chunks grow from their initial size again. */
+    (void)checkedAlloc(r, 1500);
+    CR_RegionStats stats;
+    CR_RegionGetStats(r, &stats);
+    assert_true(stats.chunk_count == 2);
+    assert_true(stats.chunk_bytes == 1024 + 2048);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+#endif
+
+#ifndef CREGION_ALWAYS_FRESH_MALLOC
+  testGroupStart("extending allocations in place");
+  {
+    CR_Region *r = checkedRegion();
+
+    unsigned char *data = checkedAlloc(r, 10);
+    assert_true(CR_RegionExtend(r, data, 10, 10));
+    assert_true(CR_RegionExtend(r, data, 10, 100));
+    assert_true(!CR_RegionExtend(r, data, 100, 50));
+    assert_true(!CR_RegionExtend(r, data, 100, 256 * 1024));
+    assert_true(!CR_RegionExtend(r, data, 100, SIZE_MAX));
+    memset(data, 0x11, 100);
+
+    unsigned char *next = checkedAlloc(r, 8);
+    assert_true(next >= data + 100);
+    assert_true(!CR_RegionExtend(r, data, 100, 200));
+    assert_true(!CR_RegionExtend(r, next, 16, 24));
+
+    /* Extending beyond the current chunk fails. */
+    assert_true(!CR_RegionExtend(r, next, 8, 200000));
+    assert_true(data[99] == 0x11);
+
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+#endif
+
   testGroupStart("callback calling at exit");
   {
     CR_Region *r1 = checkedRegion();
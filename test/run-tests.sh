@@ -1,7 +1,7 @@
 #!/bin/sh -e
 
 # Names of tests specified in the order to run.
-tests="safe-math region global-region alloc-growable mempool"
+tests="safe-math chunk-cache page-alloc region global-region alloc-growable mempool handle-pool"
 
 for test in $tests; do
   test -t 1 &&